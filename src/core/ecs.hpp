@@ -4,73 +4,248 @@
 #ifndef ECS_HPP
 #define ECS_HPP
 
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+// the SIMD paths follow the instruction set the build targets, see
+// ENGINE_SIMD in CMakeLists.txt. MSVC never defines __SSE4_1__, but /arch:AVX
+// and up imply it, and it can be asked for explicitly with -DECS_SSE4_1
+#if defined(__AVX2__)
+#define ECS_AVX2
+#endif
+#if (defined(__SSE4_1__) || defined(__AVX__)) && !defined(ECS_SSE4_1)
+#define ECS_SSE4_1
+#endif
+
+#if defined(ECS_AVX2) || defined(ECS_SSE4_1)
+#include <immintrin.h>
+#endif
+
+#include "core/job_system.hpp"
+
 namespace ecs {
 
-// storage would be u32/u64 or something similar, its the underlaying storage of
-// the bits
-template <typename storage_t> class bit_set_t {
+// fixed width bit set, bit_count is a multiple of 64. whole-set queries are
+// vectorized with AVX2 / SSE4.1 when available and accumulate over all words
+// instead of exiting early, so matching masks stays branch light.
+template <size_t bit_count> class bit_set_t {
+  static_assert(bit_count > 0 && bit_count % 64 == 0);
+  static constexpr size_t word_count = bit_count / 64;
+
 public:
-  bit_set_t(storage_t data = 0) : _data(data) {}
+  constexpr bit_set_t() = default;
 
-  void set(uint32_t n) {
-    assert(n < (sizeof(storage_t) * 8));
-    _data = _data | (static_cast<storage_t>(1) << n);
+  constexpr void set(uint32_t n) {
+    assert(n < bit_count);
+    _words[n / 64] |= (uint64_t(1) << (n % 64));
   }
 
-  void unset(uint32_t n) {
-    assert(n < (sizeof(storage_t) * 8));
-    _data = _data & ~(static_cast<storage_t>(1) << n);
+  constexpr void unset(uint32_t n) {
+    assert(n < bit_count);
+    _words[n / 64] &= ~(uint64_t(1) << (n % 64));
   }
 
-  void toggle(uint32_t n) {
-    assert(n < (sizeof(storage_t) * 8));
-    _data = _data ^ (static_cast<storage_t>(1) << n);
+  constexpr void toggle(uint32_t n) {
+    assert(n < bit_count);
+    _words[n / 64] ^= (uint64_t(1) << (n % 64));
   }
 
-  bool test(uint32_t n) const {
-    assert(n < (sizeof(storage_t) * 8));
-    return (_data & (static_cast<storage_t>(1) << n)) != 0;
+  constexpr bool test(uint32_t n) const {
+    assert(n < bit_count);
+    return (_words[n / 64] & (uint64_t(1) << (n % 64))) != 0;
   }
 
+  // every bit set in other is also set here
   bool test_all(const bit_set_t &other) const {
-    return (other._data & ~_data) == 0;
+#if defined(ECS_AVX2)
+    if constexpr (word_count % 4 == 0) {
+      int result = 1;
+      for (size_t w = 0; w < word_count; w += 4)
+        result &= _mm256_testc_si256(_load256(w), other._load256(w));
+      return result != 0;
+    }
+#endif
+#if defined(ECS_SSE4_1)
+    if constexpr (word_count % 2 == 0) {
+      int result = 1;
+      for (size_t w = 0; w < word_count; w += 2)
+        result &= _mm_testc_si128(_load128(w), other._load128(w));
+      return result != 0;
+    }
+#endif
+    uint64_t missing = 0;
+    for (size_t w = 0; w < word_count; w++)
+      missing |= other._words[w] & ~_words[w];
+    return missing == 0;
+  }
+
+  // at least one bit is set in both
+  bool any(const bit_set_t &other) const {
+#if defined(ECS_AVX2)
+    if constexpr (word_count % 4 == 0) {
+      int disjoint = 1;
+      for (size_t w = 0; w < word_count; w += 4)
+        disjoint &= _mm256_testz_si256(_load256(w), other._load256(w));
+      return disjoint == 0;
+    }
+#endif
+#if defined(ECS_SSE4_1)
+    if constexpr (word_count % 2 == 0) {
+      int disjoint = 1;
+      for (size_t w = 0; w < word_count; w += 2)
+        disjoint &= _mm_testz_si128(_load128(w), other._load128(w));
+      return disjoint == 0;
+    }
+#endif
+    uint64_t common = 0;
+    for (size_t w = 0; w < word_count; w++)
+      common |= _words[w] & other._words[w];
+    return common != 0;
+  }
+
+  bool any() const { return any(*this); }
+
+  bool none() const { return !any(); }
+
+  // no bit is set in both
+  bool none(const bit_set_t &other) const { return !any(other); }
+
+  // calls callback(n) for every set bit, lowest first
+  void for_each_set(auto callback) const {
+    for (size_t w = 0; w < word_count; w++) {
+      uint64_t bits = _words[w];
+      while (bits) {
+        callback(static_cast<uint32_t>(w * 64 + std::countr_zero(bits)));
+        bits &= bits - 1;
+      }
+    }
   }
 
-  constexpr uint32_t size() const { return sizeof(storage_t) * 8; }
+  uint32_t count() const {
+    uint32_t result = 0;
+    for (size_t w = 0; w < word_count; w++)
+      result += std::popcount(_words[w]);
+    return result;
+  }
+
+  bool operator==(const bit_set_t &other) const {
+    return _words == other._words;
+  }
+
+  constexpr uint32_t size() const { return bit_count; }
 
 private:
-  storage_t _data;
+#if defined(ECS_AVX2)
+  __m256i _load256(size_t w) const {
+    return _mm256_load_si256(reinterpret_cast<const __m256i *>(&_words[w]));
+  }
+#endif
+#if defined(ECS_SSE4_1)
+  __m128i _load128(size_t w) const {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(&_words[w]));
+  }
+#endif
+
+  alignas(word_count % 4 == 0 ? 32 : 16) std::array<uint64_t, word_count>
+      _words{};
 };
 
-template <typename storage_t>
-std::ostream &operator<<(std::ostream &o, const bit_set_t<storage_t> &bit_set) {
-  for (uint32_t i = 0; i < sizeof(storage_t) * 8; i++) {
+template <size_t bit_count>
+std::ostream &operator<<(std::ostream &o, const bit_set_t<bit_count> &bit_set) {
+  for (uint32_t i = 0; i < bit_count; i++) {
     o << bit_set.test(i);
   }
   return o;
 }
 
-using entity_id_t = uint32_t;
+// an entity handle is a 32 bit slot index plus a 32 bit generation, the
+// generation is bumped every time the slot is freed so stale handles to a
+// destroyed entity never alias the entity that reuses its slot
+using entity_id_t = uint64_t;
+using entity_index_t = uint32_t;
+using entity_generation_t = uint32_t;
 using component_id_t = uint32_t;
-using component_mask_t = bit_set_t<uint32_t>;
+// maximum number of component types in a process, override with
+// -DECS_MAX_COMPONENTS=256
+#ifndef ECS_MAX_COMPONENTS
+#define ECS_MAX_COMPONENTS 128
+#endif
+
+using component_mask_t = bit_set_t<ECS_MAX_COMPONENTS>;
 
 static const entity_id_t null_entity_id =
     std::numeric_limits<entity_id_t>::max();
 
-template <typename T>
-component_id_t _get_component_id_for(component_id_t &component_id_counter) {
-  static component_id_t s_component_id = component_id_counter++;
-  return s_component_id;
+constexpr entity_index_t entity_index(entity_id_t id) {
+  return static_cast<entity_index_t>(id);
+}
+
+constexpr entity_generation_t entity_generation(entity_id_t id) {
+  return static_cast<entity_generation_t>(id >> 32);
+}
+
+constexpr entity_id_t make_entity_id(entity_index_t index,
+                                     entity_generation_t generation) {
+  return (static_cast<entity_id_t>(generation) << 32) | index;
 }
 
+// compile time hash of the component type name. it is the same in every run
+// and translation unit built by the same compiler, so it can identify a
+// component type in files
+template <typename T> constexpr uint64_t component_type_hash() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  constexpr std::string_view name = __FUNCSIG__;
+#else
+  constexpr std::string_view name = __PRETTY_FUNCTION__;
+#endif
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// component ids are compile time constants, the same in every scene,
+// translation unit and build. a type gets its id from ECS_COMPONENT(type, id)
+// at global scope, using an unregistered type as a component fails to
+// compile. ids index the per scene pool table and the masks directly, so keep
+// them unique and below ECS_MAX_COMPONENTS.
+template <typename T> struct component_id_for;
+
+#define ECS_COMPONENT(type, id)                                                \
+  namespace ecs {                                                              \
+  template <>                                                                  \
+  struct component_id_for<type>                                                \
+      : std::integral_constant<component_id_t, id> {                           \
+    static_assert(id < ECS_MAX_COMPONENTS, "raise ECS_MAX_COMPONENTS");        \
+  };                                                                           \
+  }
+
+template <typename T>
+inline constexpr component_id_t component_id_of =
+    component_id_for<std::remove_cv_t<std::remove_reference_t<T>>>::value;
+
+template <typename... T>
+inline constexpr component_mask_t component_mask_of = [] {
+  component_mask_t mask{};
+  (mask.set(component_id_of<T>), ...);
+  return mask;
+}();
+
 static constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
 
 template <typename value_t, size_t page_size> struct sparse_map {
@@ -171,280 +346,2022 @@ template <typename value_t, size_t page_size> struct sparse_map {
   std::vector<uint32_t> dense_to_id;
 };
 
-template <size_t page_size> struct base_component_pool_t {
-  using page_t = std::array<uint32_t, page_size>;
+// typed, aligned, geometrically growing array. unlike a byte vector it moves
+// elements with their move constructor when it reallocates, so components
+// holding strings or shared pointers survive growth.
+template <typename T> class dense_storage_t {
+public:
+  dense_storage_t() = default;
+  dense_storage_t(const dense_storage_t &) = delete;
+  dense_storage_t &operator=(const dense_storage_t &) = delete;
 
-  base_component_pool_t(component_id_t id, uint32_t component_size)
-      : _id(id), _component_size(component_size) {}
+  ~dense_storage_t() {
+    clear();
+    _deallocate(_data, _capacity);
+  }
 
-  virtual ~base_component_pool_t() {}
+  T *data() { return _data; }
+  uint32_t size() const { return _size; }
+  uint32_t capacity() const { return _capacity; }
 
-  void *get(entity_id_t id) {
-    uint32_t page_index = id / page_size;
-    uint32_t in_page_index = id % page_size;
+  T &operator[](uint32_t index) { return _data[index]; }
 
-    page_t &page = *sparse.get(page_index);
+  // args may refer to an element of this storage, so when it is full the new
+  // element is built in the grown buffer before the old ones move out of it
+  template <typename... args_t> T &emplace_back(args_t &&...args) {
+    if (_size < _capacity) {
+      T *element = new (_data + _size) T{std::forward<args_t>(args)...};
+      ++_size;
+      return *element;
+    }
 
-    uint32_t dense_index = page[in_page_index];
+    uint32_t capacity = _capacity == 0 ? 16 : _capacity * 2;
+    T *data = _allocator.allocate(capacity);
+    T *element = new (data + _size) T{std::forward<args_t>(args)...};
+    _relocate(data, capacity);
+    ++_size;
+    return *element;
+  }
 
-    assert(dense_index != invalid_index);
+  // appends count elements, copied from source for trivially copyable T and
+  // copy constructed otherwise, growing at most once
+  void append_n(const T *source, uint32_t count) {
+    reserve(_size + count);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (count > 0)
+        std::memcpy(_data + _size, source, count * sizeof(T));
+    } else {
+      std::uninitialized_copy(source, source + count, _data + _size);
+    }
+    _size += count;
+  }
 
-    return dense.data() + (dense_index * _component_size);
+  // appends count copies of value, trivially copyable T is replicated with
+  // doubling memcpy. value must not live in this storage
+  void fill_n(const T &value, uint32_t count) {
+    reserve(_size + count);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (count > 0) {
+        T *first = _data + _size;
+        std::memcpy(first, &value, sizeof(T));
+        for (uint32_t filled = 1; filled < count; filled *= 2)
+          std::memcpy(first + filled, first,
+                      std::min(filled, count - filled) * sizeof(T));
+      }
+    } else {
+      std::uninitialized_fill_n(_data + _size, count, value);
+    }
+    _size += count;
   }
 
-  virtual void destroy(entity_id_t id) = 0;
+  // appends count elements built in place from make(i)
+  void append_n(uint32_t count, auto make) {
+    reserve(_size + count);
+    for (uint32_t i = 0; i < count; i++) {
+      new (_data + _size) T(make(i));
+      ++_size;
+    }
+  }
 
-  component_id_t _id;
-  uint32_t _component_size;
-  sparse_map<page_t, 1> sparse;
-  std::vector<uint8_t> dense;
-  std::vector<entity_id_t> dense_index_to_entity_id;
-};
+  void pop_back() {
+    assert(_size > 0);
+    std::destroy_at(_data + --_size);
+  }
 
-template <typename T, size_t page_size>
-struct component_pool_t : public base_component_pool_t<page_size> {
-  component_pool_t(component_id_t id)
-      : base_component_pool_t<page_size>(id, sizeof(T)) {}
+  void reserve(uint32_t capacity) {
+    if (capacity > _capacity)
+      _reallocate(capacity);
+  }
 
-  ~component_pool_t() override {}
+  void shrink_to_fit() {
+    if (_size < _capacity)
+      _reallocate(_size);
+  }
 
-  template <typename... args_t> T *construct(entity_id_t id, args_t &&...args) {
-    uint32_t page_index = id / page_size;
-    uint32_t in_page_index = id % page_size;
+  void clear() {
+    std::destroy(_data, _data + _size);
+    _size = 0;
+  }
 
-    if (!this->sparse.check_if_value_exist(page_index)) {
-      this->sparse.construct(page_index)->fill(invalid_index);
-    }
+private:
+  void _reallocate(uint32_t capacity) {
+    _relocate(capacity == 0 ? nullptr : _allocator.allocate(capacity),
+              capacity);
+  }
 
-    auto &page = *this->sparse.get(page_index);
+  // moves the elements into data and frees the old buffer
+  void _relocate(T *data, uint32_t capacity) {
+    if constexpr (std::is_nothrow_move_constructible_v<T> ||
+                  !std::is_copy_constructible_v<T>)
+      std::uninitialized_move(_data, _data + _size, data);
+    else
+      std::uninitialized_copy(_data, _data + _size, data);
 
-    uint32_t dense_index = page[in_page_index];
+    std::destroy(_data, _data + _size);
+    _deallocate(_data, _capacity);
 
-    assert(dense_index == invalid_index);
+    _data = data;
+    _capacity = capacity;
+  }
 
-    dense_index = this->dense.size() / sizeof(T);
+  void _deallocate(T *data, uint32_t capacity) {
+    if (data)
+      _allocator.deallocate(data, capacity);
+  }
 
-    while (this->dense.size() < (dense_index + 1) * this->_component_size) {
-      this->dense.emplace_back(0);
-    }
+  std::allocator<T> _allocator;
+  T *_data = nullptr;
+  uint32_t _size = 0;
+  uint32_t _capacity = 0;
+};
+
+// vector of trivially copyable elements that keeps the first inline_capacity
+// of them inside the object and only allocates past that
+template <typename T, uint32_t inline_capacity> class small_vector_t {
+  static_assert(std::is_trivially_copyable_v<T>);
 
-    while (this->dense_index_to_entity_id.size() <= dense_index) {
-      this->dense_index_to_entity_id.emplace_back(ecs::null_entity_id);
+public:
+  small_vector_t() = default;
+  small_vector_t(const small_vector_t &) = delete;
+  small_vector_t &operator=(const small_vector_t &) = delete;
+
+  ~small_vector_t() {
+    if (_data != _inline_data())
+      _allocator.deallocate(_data, _capacity);
+  }
+
+  T *begin() { return _data; }
+  T *end() { return _data + _size; }
+  const T *begin() const { return _data; }
+  const T *end() const { return _data + _size; }
+
+  T &operator[](uint32_t index) { return _data[index]; }
+  const T &operator[](uint32_t index) const { return _data[index]; }
+
+  uint32_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  void push_back(const T &value) {
+    if (_size == _capacity) {
+      T *data = _allocator.allocate(_capacity * 2);
+      std::memcpy(data, _data, _size * sizeof(T));
+      if (_data != _inline_data())
+        _allocator.deallocate(_data, _capacity);
+      _data = data;
+      _capacity *= 2;
     }
+    std::memcpy(_data + _size++, &value, sizeof(T));
+  }
 
-    T *component = reinterpret_cast<T *>(this->dense.data() +
-                                         (dense_index * this->_component_size));
+  // keeps the order of the remaining elements
+  void erase(uint32_t index) {
+    assert(index < _size);
+    std::memmove(_data + index, _data + index + 1,
+                 (_size - index - 1) * sizeof(T));
+    --_size;
+  }
 
-    new (component) T{std::forward<args_t>(args)...};
+  void clear() { _size = 0; }
 
-    this->dense_index_to_entity_id[dense_index] = id;
-    page[in_page_index] = dense_index;
+private:
+  T *_inline_data() { return reinterpret_cast<T *>(_inline); }
 
-    return component;
+  alignas(T) std::byte _inline[sizeof(T) * inline_capacity];
+  std::allocator<T> _allocator;
+  T *_data = _inline_data();
+  uint32_t _size = 0;
+  uint32_t _capacity = inline_capacity;
+};
+
+template <size_t page_size> class scene_t;
+
+// type erased call to a free function or a member function of an instance
+// with the signature void(scene_t &, entity_id_t), no allocation involved
+template <size_t page_size> class delegate_t {
+  using scene_type = scene_t<page_size>;
+  using function_t = void (*)(void *, scene_type &, entity_id_t);
+
+public:
+  template <auto candidate> static delegate_t make() {
+    return {nullptr, [](void *, scene_type &scene, entity_id_t id) {
+              candidate(scene, id);
+            }};
   }
 
-  void destroy(entity_id_t id) override {
-    uint32_t page_index = id / page_size;
-    uint32_t in_page_index = id % page_size;
+  template <auto candidate, typename instance_t>
+  static delegate_t make(instance_t &instance) {
+    return {&instance, [](void *instance, scene_type &scene, entity_id_t id) {
+              (static_cast<instance_t *>(instance)->*candidate)(scene, id);
+            }};
+  }
 
-    auto &page = *this->sparse.get(page_index);
+  void operator()(scene_type &scene, entity_id_t id) const {
+    _function(_instance, scene, id);
+  }
 
-    uint32_t dense_index = page[in_page_index];
+  bool operator==(const delegate_t &other) const = default;
 
-    assert(dense_index != invalid_index);
+  void *instance() const { return _instance; }
 
-    uint32_t top_dense_index = this->dense.size() / sizeof(T) - 1;
+private:
+  delegate_t(void *instance, function_t function)
+      : _instance(instance), _function(function) {}
 
-    entity_id_t top_id = this->dense_index_to_entity_id[top_dense_index];
+  void *_instance;
+  function_t _function;
+};
 
-    uint32_t top_page_index = top_id / page_size;
-    uint32_t top_in_page_index = top_id % page_size;
+// ordered list of delegates run by publish. listeners may read the scene but
+// must not make structural changes to it, record those in a command buffer.
+template <size_t page_size> class signal_t {
+  using delegate_type = delegate_t<page_size>;
 
-    auto &top_page = *this->sparse.get(top_page_index);
+public:
+  template <auto candidate> void connect() {
+    _delegates.push_back(delegate_type::template make<candidate>());
+  }
 
-    std::swap(*(T *)(&this->dense[dense_index * this->_component_size]),
-              *(T *)(&this->dense[top_dense_index * this->_component_size]));
-    std::swap(this->dense_index_to_entity_id[dense_index],
-              this->dense_index_to_entity_id[top_dense_index]);
-    std::swap(page[in_page_index], top_page[top_in_page_index]);
+  template <auto candidate, typename instance_t>
+  void connect(instance_t &instance) {
+    _delegates.push_back(delegate_type::template make<candidate>(instance));
+  }
 
-    for (uint32_t i = 0; i < sizeof(T); i++)
-      this->dense.pop_back();
+  template <auto candidate> void disconnect() {
+    _erase_if([](const delegate_type &delegate) {
+      return delegate == delegate_type::template make<candidate>();
+    });
+  }
 
-    this->dense_index_to_entity_id.pop_back();
+  template <auto candidate, typename instance_t>
+  void disconnect(instance_t &instance) {
+    _erase_if([&](const delegate_type &delegate) {
+      return delegate == delegate_type::template make<candidate>(instance);
+    });
+  }
 
-    page[in_page_index] = invalid_index;
+  // drops every delegate bound to instance
+  void disconnect(const void *instance) {
+    _erase_if([&](const delegate_type &delegate) {
+      return delegate.instance() == instance;
+    });
+  }
 
-    // check if page is empty, destroy page
-    for (uint32_t i = 0; i < page_size; i++) {
-      if (page[i] != invalid_index)
-        return;
-    }
+  void publish(scene_t<page_size> &scene, entity_id_t id) const {
+    for (uint32_t i = 0; i < _delegates.size(); i++)
+      _delegates[i](scene, id);
+  }
 
-    this->sparse.destroy(page_index);
+  bool empty() const { return _delegates.empty(); }
+
+private:
+  void _erase_if(auto predicate) {
+    for (uint32_t i = _delegates.size(); i-- > 0;)
+      if (predicate(_delegates[i]))
+        _delegates.erase(i);
   }
+
+  small_vector_t<delegate_type, 4> _delegates;
 };
 
-template <size_t page_size = 2048> class scene_t {
-  struct entity_description_t {
-    entity_id_t id;
-    component_mask_t mask;
-    bool is_valid;
-  };
+// scene ticks used by change tracking. a tick is "newer" than a reference tick
+// when it compares greater, tick 0 is never stamped so changed_since(0) matches
+// every component.
+using tick_t = uint32_t;
+
+// bookkeeping of an owning group, the first size dense entries of every owned
+// pool belong to the same entities in the same order
+struct group_data_t {
+  component_mask_t mask;
+  std::vector<component_id_t> component_ids;
+  uint32_t size = 0;
+};
 
-public:
-  scene_t(entity_id_t max_entities = 1000) 
-    : _max_entities(max_entities) 
-  {
+template <size_t page_size> struct base_component_pool_t {
+  using page_t = std::array<uint32_t, page_size>;
+
+  base_component_pool_t(component_id_t id, uint32_t component_size,
+                        const tick_t *tick, uint64_t *scene_version)
+      : _id(id), _component_size(component_size), _tick(tick),
+        _scene_version(scene_version) {}
+
+  virtual ~base_component_pool_t() {}
+
+  void *get(entity_id_t id) {
+    uint32_t page_index = entity_index(id) / page_size;
+    uint32_t in_page_index = entity_index(id) % page_size;
+
+    page_t &page = *sparse.get(page_index);
+
+    uint32_t dense_index = page[in_page_index];
+
+    assert(dense_index != invalid_index);
+
+    return at(dense_index);
   }
 
-  ~scene_t() {
-    for (auto &entity : _entities)
-      if (entity.is_valid) {
-        for (auto &component_pool : _component_pools)
-          if (entity.mask.test(component_pool->_id)) {
-            component_pool->destroy(entity.id);
-          }
-      }
+  void *at(uint32_t dense_index) {
+    return _dense_data + (dense_index * _component_size);
+  }
 
-    for (auto &component_pool : _component_pools) {
-      delete component_pool;
-    }
+  // unlike get, tolerates missing pages and stale handles
+  bool contains(entity_id_t id) {
+    uint32_t page_index = entity_index(id) / page_size;
+    uint32_t in_page_index = entity_index(id) % page_size;
+
+    if (!sparse.check_if_value_exist(page_index))
+      return false;
+
+    uint32_t dense_index = (*sparse.get(page_index))[in_page_index];
+
+    return dense_index != invalid_index &&
+           dense_index_to_entity_id[dense_index] == id;
   }
 
-  template <typename T> component_id_t get_component_id_for() {
-    return _get_component_id_for<T>(component_id_counter);
+  uint32_t dense_index_of(entity_id_t id) {
+    uint32_t dense_index = (*sparse.get(entity_index(id) / page_size))
+        [entity_index(id) % page_size];
+
+    assert(dense_index != invalid_index);
+
+    return dense_index;
   }
 
-  entity_id_t create() {
-    assert(_latest_entity < _max_entities);
-    entity_id_t id = _latest_entity;
-    ++_latest_entity;
+  void mark_changed(uint32_t dense_index) {
+    changed_ticks[dense_index] = *_tick;
+    last_changed_tick = *_tick;
+  }
 
-    if (_entities.size() <= id) {
-      entity_description_t entity_description = {
-          .id = id, .mask = {}, .is_valid = true};
+  // called on every change of membership or dense order
+  void bump_version() {
+    ++version;
+    ++*_scene_version;
+  }
 
-      _entities.push_back(entity_description);
-    } else {
-      assert(!_entities[id].is_valid);
+  // swaps two dense entries, keeping ids, ticks and the sparse side in sync
+  void swap_dense(uint32_t a, uint32_t b) {
+    if (a == b)
+      return;
+
+    bump_version();
+    _swap_components(a, b);
+    std::swap(dense_index_to_entity_id[a], dense_index_to_entity_id[b]);
+    std::swap(added_ticks[a], added_ticks[b]);
+    std::swap(changed_ticks[a], changed_ticks[b]);
+
+    for (uint32_t dense_index : {a, b}) {
+      entity_id_t id = dense_index_to_entity_id[dense_index];
+      page_t &page = *sparse.get(entity_index(id) / page_size);
+      page[entity_index(id) % page_size] = dense_index;
     }
+  }
 
-    return id;
+  // hands the ids removed since the last drain to the caller, the log only
+  // fills while track_removed is set and is meant for a single consumer
+  std::vector<entity_id_t> drain_removed() {
+    std::vector<entity_id_t> removed;
+    removed.swap(removed_log);
+    return removed;
   }
 
-  void destroy(entity_id_t id) {
-    assert(id != null_entity_id);
-    assert(_entities[id].is_valid);
-    entity_description_t &entity_description = _entities[id];
-    for (component_id_t i = 0; i < entity_description.mask.size(); i++) {
-      if (entity_description.mask.test(i)) {
-        _component_pools[i]->destroy(id);
-      }
-    }
-    entity_description.is_valid = false;
-    entity_description.mask = {};
-    --_latest_entity;
+  uint32_t size() const {
+    return static_cast<uint32_t>(dense_index_to_entity_id.size());
   }
 
-  template <typename T> T &get(entity_id_t id) {
-    assert(id != null_entity_id);
-    assert(_entities[id].is_valid);
+  virtual void reserve(uint32_t count) = 0;
+  virtual void shrink_to_fit() = 0;
 
-    component_id_t component_id = get_component_id_for<T>();
-    if (_component_pools.size() <= component_id) {
-      _component_pools.resize(component_id + 1);
-      _component_pools[component_id] =
-          new component_pool_t<T, page_size>(component_id);
+  virtual void destroy(entity_id_t id) = 0;
+
+  // gives every target a copy of the component source holds in source_pool,
+  // which is this pool or the pool of the same type in another scene. returns
+  // false without touching the targets when the type cannot be copied
+  virtual bool copy_n(base_component_pool_t &source_pool, entity_id_t source,
+                      std::span<const entity_id_t> targets) = 0;
+  // empty pool of the same type for another scene
+  virtual base_component_pool_t *
+  create_empty(const tick_t *tick, uint64_t *scene_version) const = 0;
+  // publishes the live components to the front copy of a double buffered pool
+  virtual void copy_to_front() = 0;
+
+  component_id_t _id;
+  uint32_t _component_size;
+  sparse_map<page_t, 1> sparse;
+  // live entries per sparse page, the page is freed when it drops to zero
+  std::vector<uint32_t> page_live_counts;
+  std::vector<entity_id_t> dense_index_to_entity_id;
+  // start of the typed dense array owned by component_pool_t
+  uint8_t *_dense_data = nullptr;
+
+  // parallel to dense, the tick the component was constructed / last marked
+  std::vector<tick_t> added_ticks;
+  std::vector<tick_t> changed_ticks;
+  // newest tick stamped on any entry, lets systems skip untouched pools
+  tick_t last_changed_tick = 0;
+
+  bool track_removed = false;
+  std::vector<entity_id_t> removed_log;
+
+  // current tick of the owning scene
+  const tick_t *_tick;
+
+  // structural version of this pool and the sum over all pools of the scene,
+  // cached queries compare them to tell whether they are stale
+  uint64_t version = 0;
+  uint64_t *_scene_version;
+  // owning group the pool is packed for, if any
+  group_data_t *group = nullptr;
+
+  // fired after construction, before destruction and after a patch
+  signal_t<page_size> on_construct;
+  signal_t<page_size> on_destroy;
+  signal_t<page_size> on_update;
+
+protected:
+  virtual void _swap_components(uint32_t a, uint32_t b) = 0;
+
+  // returns the sparse slot of id, creating its page if needed
+  uint32_t &_assure_slot(entity_id_t id) {
+    uint32_t page_index = entity_index(id) / page_size;
+    bump_version();
+
+    if (!sparse.check_if_value_exist(page_index)) {
+      sparse.construct(page_index)->fill(invalid_index);
+      if (page_live_counts.size() <= page_index)
+        page_live_counts.resize(page_index + 1, 0);
     }
 
-    entity_description_t &entity_description = _entities[id];
-    entity_description.mask.set(component_id);
-    return *reinterpret_cast<T *>(_component_pools[component_id]->get(id));
+    ++page_live_counts[page_index];
+    return (*sparse.get(page_index))[entity_index(id) % page_size];
   }
 
-  template <typename T, typename... args_t>
-  T &construct(entity_id_t id, args_t &&...args) {
-    assert(id != null_entity_id);
-    assert(_entities[id].is_valid);
-    assert(!_entities[id].mask.test(get_component_id_for<T>()));
+  void _push_ticks(entity_id_t id) {
+    dense_index_to_entity_id.push_back(id);
+    added_ticks.push_back(*_tick);
+    changed_ticks.push_back(*_tick);
+    last_changed_tick = *_tick;
+  }
 
-    component_id_t component_id = get_component_id_for<T>();
-    if (_component_pools.size() <= component_id) {
-      _component_pools.resize(component_id + 1);
-      _component_pools[component_id] =
-          reinterpret_cast<base_component_pool_t<page_size> *>(
-              new component_pool_t<T, page_size>(component_id));
-    }
+  void _release_slot(entity_id_t id) {
+    uint32_t page_index = entity_index(id) / page_size;
+    bump_version();
 
-    entity_description_t &entity_description = _entities[id];
-    entity_description.mask.set(component_id);
-    return *(reinterpret_cast<component_pool_t<T, page_size> *>(
-                 _component_pools[component_id])
-                 ->construct(id, std::forward<args_t>(args)...));
+    (*sparse.get(page_index))[entity_index(id) % page_size] = invalid_index;
+
+    if (--page_live_counts[page_index] == 0)
+      sparse.destroy(page_index);
   }
+};
 
-  template <typename T> void remove(entity_id_t id) {
-    assert(id != null_entity_id);
-    assert(_entities[id].is_valid);
-    assert(_entities[id].mask.test(get_component_id_for<T>()));
+template <typename T, size_t page_size>
+struct component_pool_t : public base_component_pool_t<page_size> {
+  component_pool_t(component_id_t id, const tick_t *tick,
+                   uint64_t *scene_version)
+      : base_component_pool_t<page_size>(id, sizeof(T), tick, scene_version) {}
 
-    component_id_t component_id = get_component_id_for<T>();
-    if (_component_pools.size() <= component_id) {
-      _component_pools.resize(component_id + 1);
-      _component_pools[component_id] =
-          reinterpret_cast<base_component_pool_t<page_size> *>(
-              new component_pool_t<T, page_size>(component_id));
-    }
+  ~component_pool_t() override {}
 
-    _component_pools[component_id]->destroy(id);
+  template <typename... args_t> T *construct(entity_id_t id, args_t &&...args) {
+    uint32_t &dense_index = this->_assure_slot(id);
 
-    entity_description_t &entity_description = _entities[id];
-    entity_description.mask.unset(component_id);
+    assert(dense_index == invalid_index);
+
+    dense_index = dense.size();
+    T *component = &dense.emplace_back(std::forward<args_t>(args)...);
+    this->_push_ticks(id);
+    _sync();
+
+    return component;
   }
 
-  template <typename... T> bool has(entity_id_t id) {
-    assert(id != null_entity_id);
-    assert(_entities[id].is_valid);
+  // constructs one component per id from the same arguments, the new
+  // components are contiguous in dense and the first one is returned
+  template <typename... args_t>
+  T *construct_n(std::span<const entity_id_t> ids, const args_t &...args) {
+    uint32_t first_dense_index = dense.size();
 
-    component_mask_t mask{};
-    component_id_t component_ids[] = {get_component_id_for<T>()...};
-    for (uint32_t i = 0; i < sizeof...(T); i++) {
-      mask.set(component_ids[i]);
+    // copy the arguments first, they may refer to a component of this pool
+    // that reserve is about to move
+    std::tuple<std::decay_t<args_t>...> arguments{args...};
+    reserve(first_dense_index + static_cast<uint32_t>(ids.size()));
+
+    for (entity_id_t id : ids) {
+      uint32_t &dense_index = this->_assure_slot(id);
+
+      assert(dense_index == invalid_index);
+
+      dense_index = dense.size();
+      std::apply([&](const auto &...copies) { dense.emplace_back(copies...); },
+                 arguments);
+      this->_push_ticks(id);
     }
+    _sync();
 
-    entity_description_t &entity_description = _entities[id];
+    return dense.data() + first_dense_index;
+  }
 
-    return entity_description.mask.test_all(mask);
+  // appends one copy of value per id in a single batch
+  void fill_n(std::span<const entity_id_t> ids, const T &value) {
+    _append_slots(ids);
+    dense.fill_n(value, static_cast<uint32_t>(ids.size()));
+    _sync();
   }
 
-  template <typename... T> void for_all(auto callback) {
-    if constexpr (sizeof...(T) == 0) {
-      for (auto &entity : _entities)
-        if (entity.is_valid) {
-          callback(entity.id);
-        }
+  // appends values[i] for ids[i] in a single batch
+  void append_n(std::span<const entity_id_t> ids, const T *values) {
+    _append_slots(ids);
+    dense.append_n(values, static_cast<uint32_t>(ids.size()));
+    _sync();
+  }
+
+  bool copy_n(base_component_pool_t<page_size> &source_pool, entity_id_t source,
+              std::span<const entity_id_t> targets) override {
+    if constexpr (std::is_copy_constructible_v<T>) {
+      // copy first, filling may reallocate dense when source_pool is this
+      T prototype = *reinterpret_cast<T *>(source_pool.get(source));
+      fill_n(targets, prototype);
+      return true;
     } else {
-      component_mask_t mask{};
-      component_id_t component_ids[] = {get_component_id_for<T>()...};
-      for (uint32_t i = 0; i < sizeof...(T); i++) {
-        mask.set(component_ids[i]);
-      }
-      for (auto &entity : _entities)
-        if (entity.is_valid && entity.mask.test_all(mask)) {
-          callback(entity.id, get<T>(entity.id)...);
-        }
+      return false;
     }
   }
 
-private:
-  // TODO: make a free entities queue
-  const entity_id_t _max_entities;
-  entity_id_t _latest_entity = 0;
-  std::vector<entity_description_t> _entities;
-  std::vector<base_component_pool_t<page_size> *> _component_pools;
-  component_id_t component_id_counter = 0;
-  
+  base_component_pool_t<page_size> *
+  create_empty(const tick_t *tick, uint64_t *scene_version) const override {
+    return new component_pool_t(this->_id, tick, scene_version);
+  }
+
+  // swap and pop, O(1)
+  void destroy(entity_id_t id) override {
+    uint32_t page_index = entity_index(id) / page_size;
+    uint32_t in_page_index = entity_index(id) % page_size;
+
+    uint32_t dense_index = (*this->sparse.get(page_index))[in_page_index];
+
+    assert(dense_index != invalid_index);
+
+    uint32_t top_dense_index = dense.size() - 1;
+
+    if (dense_index != top_dense_index) {
+      entity_id_t top_id = this->dense_index_to_entity_id[top_dense_index];
+
+      dense[dense_index] = std::move(dense[top_dense_index]);
+      this->dense_index_to_entity_id[dense_index] = top_id;
+      this->added_ticks[dense_index] = this->added_ticks[top_dense_index];
+      this->changed_ticks[dense_index] = this->changed_ticks[top_dense_index];
+      (*this->sparse.get(entity_index(top_id) / page_size))
+          [entity_index(top_id) % page_size] = dense_index;
+    }
+
+    dense.pop_back();
+    this->dense_index_to_entity_id.pop_back();
+    this->added_ticks.pop_back();
+    this->changed_ticks.pop_back();
+
+    if (front) {
+      if (dense_index != top_dense_index)
+        (*front)[dense_index] = std::move((*front)[top_dense_index]);
+      front->pop_back();
+    }
+
+    if (this->track_removed)
+      this->removed_log.push_back(id);
+
+    this->_release_slot(id);
+  }
+
+  void reserve(uint32_t count) override {
+    dense.reserve(count);
+    this->dense_index_to_entity_id.reserve(count);
+    this->added_ticks.reserve(count);
+    this->changed_ticks.reserve(count);
+    if (front)
+      front->reserve(count);
+    _sync();
+  }
+
+  void shrink_to_fit() override {
+    dense.shrink_to_fit();
+    this->dense_index_to_entity_id.shrink_to_fit();
+    this->added_ticks.shrink_to_fit();
+    this->changed_ticks.shrink_to_fit();
+    if (front)
+      front->shrink_to_fit();
+    _sync();
+  }
+
+  // call after appending to dense directly, e.g. when loading a snapshot
+  void dense_appended() { _sync(); }
+
+  void double_buffer(bool enable) {
+    if (!enable) {
+      front.reset();
+      return;
+    }
+    if (!front) {
+      front = std::make_unique<dense_storage_t<T>>();
+      _sync();
+    }
+  }
+
+  void copy_to_front() override {
+    if (!front)
+      return;
+
+    _sync();
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (dense.size() > 0)
+        std::memcpy(front->data(), dense.data(), dense.size() * sizeof(T));
+    } else if constexpr (std::is_copy_assignable_v<T>) {
+      std::copy_n(dense.data(), dense.size(), front->data());
+    }
+  }
+
+  dense_storage_t<T> dense;
+  // copy of dense as of the last copy_to_front, only while double buffered.
+  // it follows every structural change of dense so both share dense indices,
+  // entries appended since the last publish start with their initial value
+  std::unique_ptr<dense_storage_t<T>> front;
+
+protected:
+  void _swap_components(uint32_t a, uint32_t b) override {
+    using std::swap;
+    swap(dense[a], dense[b]);
+    if (front)
+      swap((*front)[a], (*front)[b]);
+  }
+
+private:
+  void _sync() {
+    this->_dense_data = reinterpret_cast<uint8_t *>(dense.data());
+    // only copyable types can be double buffered, see scene_t::double_buffer
+    if constexpr (std::is_copy_constructible_v<T>)
+      if (front && front->size() < dense.size())
+        front->append_n(dense.data() + front->size(),
+                        dense.size() - front->size());
+  }
+
+  // registers ids at the end of dense, the caller appends their components
+  void _append_slots(std::span<const entity_id_t> ids) {
+    uint32_t dense_index = dense.size();
+    reserve(dense_index + static_cast<uint32_t>(ids.size()));
+
+    for (entity_id_t id : ids) {
+      uint32_t &slot = this->_assure_slot(id);
+      assert(slot == invalid_index);
+      slot = dense_index++;
+      this->_push_ticks(id);
+    }
+  }
+};
+
+// empty component types are tags, an entity owns one through its mask bit
+// alone. every tag shares one stateless instance.
+template <typename T>
+  requires std::is_empty_v<T>
+inline T tag_instance{};
+
+// pool of a tag type. it stores nothing per entity unless track_entities is
+// set, then it keeps the id list and sparse pages of the tagged entities (no
+// component bytes, no ticks) so they can be enumerated.
+template <typename T, size_t page_size>
+struct tag_pool_t : public base_component_pool_t<page_size> {
+  tag_pool_t(component_id_t id, const tick_t *tick, uint64_t *scene_version)
+      : base_component_pool_t<page_size>(id, 0, tick, scene_version) {}
+
+  // membership lives in the entity masks, so every call is a structural change
+  template <typename... args_t> T *construct(entity_id_t id, args_t &&...) {
+    this->bump_version();
+    if (track_entities)
+      _add(id);
+    return &tag_instance<T>;
+  }
+
+  template <typename... args_t>
+  T *construct_n(std::span<const entity_id_t> ids, const args_t &...) {
+    this->bump_version();
+    if (track_entities)
+      for (entity_id_t id : ids)
+        _add(id);
+    return &tag_instance<T>;
+  }
+
+  bool copy_n(base_component_pool_t<page_size> &, entity_id_t,
+              std::span<const entity_id_t> targets) override {
+    construct_n(targets);
+    return true;
+  }
+
+  base_component_pool_t<page_size> *
+  create_empty(const tick_t *tick, uint64_t *scene_version) const override {
+    return new tag_pool_t(this->_id, tick, scene_version);
+  }
+
+  void copy_to_front() override {}
+
+  void destroy(entity_id_t id) override {
+    this->bump_version();
+    if (this->track_removed)
+      this->removed_log.push_back(id);
+    if (!track_entities)
+      return;
+
+    uint32_t dense_index = this->dense_index_of(id);
+    entity_id_t top_id = this->dense_index_to_entity_id.back();
+
+    this->dense_index_to_entity_id[dense_index] = top_id;
+    (*this->sparse.get(entity_index(top_id) / page_size))
+        [entity_index(top_id) % page_size] = dense_index;
+    this->dense_index_to_entity_id.pop_back();
+
+    this->_release_slot(id);
+  }
+
+  void reserve(uint32_t count) override {
+    if (track_entities)
+      this->dense_index_to_entity_id.reserve(count);
+  }
+
+  void shrink_to_fit() override {
+    this->dense_index_to_entity_id.shrink_to_fit();
+  }
+
+  // drops the tracked list and its sparse pages
+  void clear_entities() {
+    for (entity_id_t id : this->dense_index_to_entity_id)
+      this->_release_slot(id);
+    this->dense_index_to_entity_id.clear();
+  }
+
+  bool track_entities = false;
+
+protected:
+  void _swap_components(uint32_t, uint32_t) override {}
+
+private:
+  void _add(entity_id_t id) {
+    uint32_t &dense_index = this->_assure_slot(id);
+
+    assert(dense_index == invalid_index);
+
+    dense_index = this->size();
+    this->dense_index_to_entity_id.push_back(id);
+  }
+};
+
+template <typename T, size_t page_size>
+using pool_for_t =
+    std::conditional_t<std::is_empty_v<T>, tag_pool_t<T, page_size>,
+                       component_pool_t<T, page_size>>;
+
+// view<T...>(exclude<X...>) skips entities owning any of X...
+template <typename... T> struct exclude_t {};
+template <typename... T> inline constexpr exclude_t<T...> exclude{};
+
+// iterates the entities owning every component in T..., driven by the dense
+// array of the smallest participating pool while the others are only probed.
+// a view never creates pools, a missing pool simply makes the view empty.
+// adding or removing components of the viewed types while iterating is not
+// allowed. changed_since / added_since narrow the view to components stamped
+// after a tick, a pool with nothing newer empties the view without a walk.
+// tags in T... and excluded types are checked against the entity mask, tags
+// never drive the iteration so at least one T must be a real component.
+template <size_t page_size, typename... T> class view_t {
+  static_assert(sizeof...(T) > 0);
+
+  using pool_t = base_component_pool_t<page_size>;
+  using pools_t = std::array<pool_t *, sizeof...(T)>;
+  using first_t = std::tuple_element_t<0, std::tuple<T...>>;
+  using scene_type = scene_t<page_size>;
+
+  static_assert((!std::is_empty_v<T> || ...),
+                "a view needs one component that is not a tag");
+
+public:
+  class iterator {
+  public:
+    iterator(view_t *view, uint32_t dense_index)
+        : _view(view), _dense_index(dense_index) {
+      _skip();
+    }
+
+    std::tuple<entity_id_t, T &...> operator*() const {
+      return _view->_fetch(_dense_index, std::index_sequence_for<T...>{});
+    }
+
+    iterator &operator++() {
+      ++_dense_index;
+      _skip();
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return _dense_index == other._dense_index;
+    }
+
+  private:
+    // stops on the next entity the other pools also contain
+    void _skip() {
+      while (_dense_index < _view->_end() &&
+             !_view->_accepts(
+                 _view->_lead->dense_index_to_entity_id[_dense_index],
+                 _dense_index))
+        ++_dense_index;
+    }
+
+    view_t *_view;
+    uint32_t _dense_index;
+  };
+
+  view_t(const pools_t &pools, const scene_type *scene = nullptr,
+         const component_mask_t &excluded = {})
+      : _pools(pools), _scene(scene), _excluded(excluded) {
+    constexpr bool is_tag[] = {std::is_empty_v<T>...};
+
+    for (size_t i = 0; i < _pools.size(); i++) {
+      if (_pools[i] == nullptr) {
+        _lead = nullptr;
+        return;
+      }
+      if (is_tag[i])
+        _required.set(_pools[i]->_id);
+      else if (_lead == nullptr || _pools[i]->size() < _lead->size())
+        _lead = _pools[i];
+    }
+
+    _check_mask = _required.any() || _excluded.any();
+    assert((!_check_mask || _scene != nullptr) && "mask checks need the scene");
+  }
+
+  iterator begin() { return iterator{this, 0}; }
+  iterator end() { return iterator{this, _end()}; }
+
+  // upper bound on the number of entities the view yields
+  uint32_t size_hint() const { return _end(); }
+
+  // keeps entities whose U was constructed or marked changed after tick
+  template <typename U = first_t> view_t changed_since(tick_t tick) const {
+    static_assert(!std::is_empty_v<U>, "tags carry no ticks");
+    return _filtered<U>(tick, false);
+  }
+
+  // keeps entities whose U was constructed after tick
+  template <typename U = first_t> view_t added_since(tick_t tick) const {
+    static_assert(!std::is_empty_v<U>, "tags carry no ticks");
+    return _filtered<U>(tick, true);
+  }
+
+  void each(auto callback) {
+    for (uint32_t dense_index = 0; dense_index < _end(); dense_index++) {
+      entity_id_t id = _lead->dense_index_to_entity_id[dense_index];
+      if (_accepts(id, dense_index))
+        _call(callback, id, dense_index, std::index_sequence_for<T...>{});
+    }
+  }
+
+  // runs callback(entity, T&...) on the shared job system. the dense range of
+  // the lead pool is cut into chunks of grain_size entries, so chunk boundaries
+  // are deterministic. callbacks must not make structural changes to the scene.
+  void par_for_each(auto callback, uint32_t grain_size = 1024,
+                    core::job_system_t &job_system =
+                        core::job_system_t::getInstance()) {
+    job_system.parallelFor(
+        _end(), grain_size, [&](uint32_t begin, uint32_t end) {
+          for (uint32_t dense_index = begin; dense_index < end; dense_index++) {
+            entity_id_t id = _lead->dense_index_to_entity_id[dense_index];
+            if (_accepts(id, dense_index))
+              _call(callback, id, dense_index, std::index_sequence_for<T...>{});
+          }
+        });
+  }
+
+  template <typename U> U &get(entity_id_t id) {
+    if constexpr (std::is_empty_v<U>)
+      return tag_instance<U>;
+
+    constexpr size_t index = _index_of<U, T...>();
+    assert(_pools[index] != nullptr && _pools[index]->contains(id));
+    return *reinterpret_cast<U *>(_pools[index]->get(id));
+  }
+
+private:
+  template <typename U, typename first_t, typename... rest_t>
+  static constexpr size_t _index_of() {
+    if constexpr (std::is_same_v<U, first_t>)
+      return 0;
+    else
+      return 1 + _index_of<U, rest_t...>();
+  }
+
+  uint32_t _end() const { return _lead == nullptr ? 0 : _lead->size(); }
+
+  template <typename U> view_t _filtered(tick_t tick, bool added) const {
+    view_t view = *this;
+    view._filter_pool = _pools[_index_of<U, T...>()];
+    view._filter_tick = tick;
+    view._filter_added = added;
+
+    // added ticks never exceed the newest changed tick
+    if (view._filter_pool == nullptr ||
+        view._filter_pool->last_changed_tick <= tick)
+      view._lead = nullptr;
+    return view;
+  }
+
+  bool _contains_all(entity_id_t id) const {
+    constexpr bool is_tag[] = {std::is_empty_v<T>...};
+
+    for (size_t i = 0; i < _pools.size(); i++)
+      if (!is_tag[i] && _pools[i] != _lead && !_pools[i]->contains(id))
+        return false;
+
+    if (!_check_mask)
+      return true;
+
+    const component_mask_t &mask = _scene->mask(id);
+    return mask.test_all(_required) && mask.none(_excluded);
+  }
+
+  bool _accepts(entity_id_t id, uint32_t dense_index) const {
+    if (!_contains_all(id))
+      return false;
+    if (_filter_pool == nullptr)
+      return true;
+
+    uint32_t filter_index = _filter_pool == _lead
+                                ? dense_index
+                                : _filter_pool->dense_index_of(id);
+    const std::vector<tick_t> &ticks = _filter_added
+                                           ? _filter_pool->added_ticks
+                                           : _filter_pool->changed_ticks;
+    return ticks[filter_index] > _filter_tick;
+  }
+
+  template <size_t I>
+  auto &_component(entity_id_t id, uint32_t dense_index) const {
+    using component_t = std::tuple_element_t<I, std::tuple<T...>>;
+    if constexpr (std::is_empty_v<component_t>)
+      return tag_instance<component_t>;
+
+    pool_t *pool = _pools[I];
+    if (pool == _lead)
+      return *reinterpret_cast<component_t *>(pool->at(dense_index));
+    return *reinterpret_cast<component_t *>(pool->get(id));
+  }
+
+  template <size_t... I>
+  std::tuple<entity_id_t, T &...> _fetch(uint32_t dense_index,
+                                         std::index_sequence<I...>) const {
+    entity_id_t id = _lead->dense_index_to_entity_id[dense_index];
+    return {id, _component<I>(id, dense_index)...};
+  }
+
+  template <size_t... I>
+  void _call(auto &callback, entity_id_t id, uint32_t dense_index,
+             std::index_sequence<I...>) const {
+    callback(id, _component<I>(id, dense_index)...);
+  }
+
+  pools_t _pools;
+  pool_t *_lead = nullptr;
+
+  const scene_type *_scene;
+  // tag bits the entity must have, and bits it must not have
+  component_mask_t _required{};
+  component_mask_t _excluded;
+  bool _check_mask = false;
+
+  pool_t *_filter_pool = nullptr;
+  tick_t _filter_tick = 0;
+  bool _filter_added = false;
+};
+
+// owning group over T..., the scene keeps the first size() entries of every
+// owned pool aligned so iteration is a zipped walk over the dense arrays with
+// no sparse lookups. a pool can be owned by one group only. the same structural
+// restrictions as for views apply while iterating.
+template <size_t page_size, typename... T> class group_t {
+  static_assert(sizeof...(T) > 1);
+
+  using pools_t = std::tuple<component_pool_t<T, page_size> *...>;
+
+public:
+  class iterator {
+  public:
+    iterator(const group_t *group, uint32_t dense_index)
+        : _group(group), _dense_index(dense_index) {}
+
+    std::tuple<entity_id_t, T &...> operator*() const {
+      return _group->_fetch(_dense_index, std::index_sequence_for<T...>{});
+    }
+
+    iterator &operator++() {
+      ++_dense_index;
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return _dense_index == other._dense_index;
+    }
+
+  private:
+    const group_t *_group;
+    uint32_t _dense_index;
+  };
+
+  group_t(const pools_t &pools, const group_data_t *data)
+      : _pools(pools), _data(data) {}
+
+  iterator begin() const { return iterator{this, 0}; }
+  iterator end() const { return iterator{this, size()}; }
+
+  uint32_t size() const { return _data->size; }
+
+  bool contains(entity_id_t id) const {
+    auto *pool = std::get<0>(_pools);
+    return pool->contains(id) && pool->dense_index_of(id) < size();
+  }
+
+  // position of a member in group order, the index into entities() and data()
+  uint32_t index(entity_id_t id) const {
+    assert(contains(id));
+    return std::get<0>(_pools)->dense_index_of(id);
+  }
+
+  // entity ids in group order
+  const entity_id_t *entities() const {
+    return std::get<0>(_pools)->dense_index_to_entity_id.data();
+  }
+
+  // owned component array, the first size() entries are in group order
+  template <typename U> U *data() const {
+    return std::get<component_pool_t<U, page_size> *>(_pools)->dense.data();
+  }
+
+  // front copy of a double buffered U, in the same order as data<U>()
+  template <typename U> const U *front() const {
+    auto *pool = std::get<component_pool_t<U, page_size> *>(_pools);
+    assert(pool->front && "component type is not double buffered");
+    return pool->front->data();
+  }
+
+  void each(auto callback) const {
+    for (uint32_t dense_index = 0; dense_index < size(); dense_index++)
+      _call(callback, dense_index, std::index_sequence_for<T...>{});
+  }
+
+  void par_for_each(auto callback, uint32_t grain_size = 1024,
+                    core::job_system_t &job_system =
+                        core::job_system_t::getInstance()) const {
+    job_system.parallelFor(
+        size(), grain_size, [&](uint32_t begin, uint32_t end) {
+          for (uint32_t dense_index = begin; dense_index < end; dense_index++)
+            _call(callback, dense_index, std::index_sequence_for<T...>{});
+        });
+  }
+
+private:
+  template <size_t... I>
+  std::tuple<entity_id_t, T &...> _fetch(uint32_t dense_index,
+                                         std::index_sequence<I...>) const {
+    return {entities()[dense_index],
+            std::get<I>(_pools)->dense[dense_index]...};
+  }
+
+  template <size_t... I>
+  void _call(auto &callback, uint32_t dense_index,
+             std::index_sequence<I...>) const {
+    callback(entities()[dense_index],
+             std::get<I>(_pools)->dense[dense_index]...);
+  }
+
+  pools_t _pools;
+  const group_data_t *_data;
+};
+
+// persistent view over T... that caches the matching entities together with
+// their dense indices. the cache is rebuilt on the first use after a
+// structural change (construct, remove, destroy, sort, group packing) to one
+// of the involved pools, writes to component values keep it valid. while
+// nothing changed anywhere in the scene a use costs a single compare. the
+// structural restrictions of views apply while iterating.
+template <size_t page_size, typename... T> class query_t {
+  static_assert((!std::is_empty_v<T> || ...),
+                "a query needs one component that is not a tag");
+
+  using pool_t = base_component_pool_t<page_size>;
+  using scene_type = scene_t<page_size>;
+  static constexpr size_t count = sizeof...(T);
+
+public:
+  // pools holds the T... pools followed by the excluded ones
+  query_t(std::vector<pool_t *> pools, const scene_type *scene,
+          const component_mask_t &excluded, const uint64_t *scene_version)
+      : _pools(std::move(pools)), _versions(_pools.size(), 0), _scene(scene),
+        _excluded(excluded), _scene_version(scene_version) {}
+
+  uint32_t size() {
+    _refresh();
+    return static_cast<uint32_t>(_entities.size());
+  }
+
+  std::span<const entity_id_t> entities() {
+    _refresh();
+    return _entities;
+  }
+
+  void each(auto callback) {
+    _refresh();
+    for (uint32_t row = 0; row < _entities.size(); row++) {
+      entity_id_t id = _entities[row];
+      _call(callback, id, &_indices[size_t(row) * count],
+            std::index_sequence_for<T...>{});
+    }
+  }
+
+private:
+  void _refresh() {
+    if (_seen_version == *_scene_version)
+      return;
+    _seen_version = *_scene_version;
+
+    bool stale = false;
+    for (size_t i = 0; i < _pools.size(); i++)
+      if (_versions[i] != _pools[i]->version) {
+        _versions[i] = _pools[i]->version;
+        stale = true;
+      }
+
+    if (stale)
+      _rebuild();
+  }
+
+  void _rebuild() {
+    constexpr bool is_tag[] = {std::is_empty_v<T>...};
+
+    std::array<pool_t *, count> pools;
+    std::copy_n(_pools.begin(), count, pools.begin());
+
+    _entities.clear();
+    _indices.clear();
+    view_t<page_size, T...> view(pools, _scene, _excluded);
+    view.each([&](entity_id_t id, T &...) {
+      _entities.push_back(id);
+      for (size_t i = 0; i < count; i++)
+        _indices.push_back(is_tag[i] ? 0 : pools[i]->dense_index_of(id));
+    });
+  }
+
+  template <size_t I> auto &_component(const uint32_t *indices) const {
+    using component_t = std::tuple_element_t<I, std::tuple<T...>>;
+    if constexpr (std::is_empty_v<component_t>)
+      return tag_instance<component_t>;
+    else
+      return *reinterpret_cast<component_t *>(_pools[I]->at(indices[I]));
+  }
+
+  template <size_t... I>
+  void _call(auto &callback, entity_id_t &id, const uint32_t *indices,
+             std::index_sequence<I...>) const {
+    callback(id, _component<I>(indices)...);
+  }
+
+  std::vector<pool_t *> _pools;
+  std::vector<uint64_t> _versions;
+
+  const scene_type *_scene;
+  component_mask_t _excluded;
+
+  const uint64_t *_scene_version;
+  // never a valid scene version, the first use always checks the pools
+  uint64_t _seen_version = ~uint64_t(0);
+
+  // one row of count dense indices per cached entity
+  std::vector<entity_id_t> _entities;
+  std::vector<uint32_t> _indices;
+};
+
+template <size_t page_size> class snapshot_t;
+template <size_t page_size> class prefab_library_t;
+
+// full runs std::sort, insertion is cheaper for arrays that are already nearly
+// in order, e.g. when the same key is re-sorted every frame
+enum class sort_mode_t { full, insertion };
+
+template <size_t page_size = 2048> class scene_t {
+  // while an entity is dead its id holds the index of the next free slot
+  // (intrusive free list) and the generation the slot will be reused with
+  struct entity_description_t {
+    entity_id_t id;
+    component_mask_t mask;
+    bool is_valid;
+  };
+
+public:
+  // reserved_entities is only a capacity hint, the entity table grows past it
+  scene_t(entity_id_t reserved_entities = 1000) {
+    _entities.reserve(reserved_entities);
+  }
+
+  ~scene_t() {
+    // pools destroy their remaining components
+    for (auto &component_pool : _component_pools) {
+      delete component_pool;
+    }
+  }
+
+  // pools keep a pointer to the scene tick
+  scene_t(const scene_t &) = delete;
+  scene_t &operator=(const scene_t &) = delete;
+
+  template <typename T> static constexpr component_id_t get_component_id_for() {
+    return component_id_of<T>;
+  }
+
+  entity_id_t create() {
+    if (_free_head == invalid_index) {
+      assert(_entities.size() < invalid_index);
+      entity_id_t id =
+          make_entity_id(static_cast<entity_index_t>(_entities.size()), 0);
+
+      entity_description_t entity_description = {
+          .id = id, .mask = {}, .is_valid = true};
+
+      _entities.push_back(entity_description);
+      ++_alive;
+      return id;
+    }
+
+    entity_index_t index = _free_head;
+    entity_description_t &entity_description = _entities[index];
+    assert(!entity_description.is_valid);
+
+    _free_head = entity_index(entity_description.id);
+    entity_description.id =
+        make_entity_id(index, entity_generation(entity_description.id));
+    entity_description.is_valid = true;
+    ++_alive;
+
+    return entity_description.id;
+  }
+
+  void destroy(entity_id_t id) {
+    assert(valid(id));
+    entity_description_t &entity_description = _entities[entity_index(id)];
+    // listeners see the whole entity, groups are left while all grouped
+    // components are still there
+    entity_description.mask.for_each_set([&](component_id_t component_id) {
+      _component_pools[component_id]->on_destroy.publish(*this, id);
+    });
+    entity_description.mask.for_each_set([&](component_id_t component_id) {
+      _leave_group(id, _component_pools[component_id]);
+    });
+    entity_description.mask.for_each_set([&](component_id_t component_id) {
+      _component_pools[component_id]->destroy(id);
+    });
+    entity_description.is_valid = false;
+    entity_description.mask = {};
+    entity_description.id =
+        make_entity_id(_free_head, entity_generation(id) + 1);
+    _free_head = entity_index(id);
+    --_alive;
+  }
+
+  bool valid(entity_id_t id) const {
+    entity_index_t index = entity_index(id);
+    return id != null_entity_id && index < _entities.size() &&
+           _entities[index].is_valid && _entities[index].id == id;
+  }
+
+  void reserve(uint32_t entity_count) { _entities.reserve(entity_count); }
+
+  template <typename T> void reserve(uint32_t component_count) {
+    _assure_pool<T>()->reserve(component_count);
+  }
+
+  void shrink_to_fit() {
+    _entities.shrink_to_fit();
+    for (auto &component_pool : _component_pools)
+      if (component_pool)
+        component_pool->shrink_to_fit();
+  }
+
+  uint32_t alive() const { return _alive; }
+
+  // construct and patch stamp components with the current tick. systems keep
+  // the tick they last ran at and ask for changed_since(that tick), the frame
+  // loop advances the tick once per frame.
+  tick_t tick() const { return _tick; }
+  tick_t advance_tick() { return ++_tick; }
+
+  // creates out.size() entities, recycled slots first, growing the entity
+  // table at most once
+  void create_n(std::span<entity_id_t> out) {
+    size_t created = 0;
+    while (created < out.size() && _free_head != invalid_index)
+      out[created++] = create();
+
+    size_t remaining = out.size() - created;
+    if (remaining == 0)
+      return;
+
+    assert(_entities.size() + remaining < invalid_index);
+    _entities.reserve(_entities.size() + remaining);
+    for (; created < out.size(); created++) {
+      entity_id_t id =
+          make_entity_id(static_cast<entity_index_t>(_entities.size()), 0);
+      _entities.push_back({.id = id, .mask = {}, .is_valid = true});
+      out[created] = id;
+    }
+    _alive += static_cast<uint32_t>(remaining);
+  }
+
+  std::vector<entity_id_t> create_n(uint32_t count) {
+    std::vector<entity_id_t> ids(count);
+    create_n(std::span<entity_id_t>(ids));
+    return ids;
+  }
+
+  // creates count entities holding a copy of every component of prototype,
+  // components that cannot be copied are left out
+  std::vector<entity_id_t> clone_n(entity_id_t prototype, uint32_t count) {
+    assert(valid(prototype));
+
+    std::vector<entity_id_t> ids = create_n(count);
+    const component_mask_t &mask = _entities[entity_index(prototype)].mask;
+    component_mask_t copied = mask;
+
+    mask.for_each_set([&](component_id_t component_id) {
+      base_component_pool_t<page_size> *pool = _component_pools[component_id];
+      if (!pool->copy_n(*pool, prototype, ids))
+        copied.unset(component_id);
+    });
+    _finish_clones(ids, copied);
+
+    return ids;
+  }
+
+  template <typename T> T &get(entity_id_t id) {
+    assert(valid(id));
+
+    component_id_t component_id = get_component_id_for<T>();
+    assert(_entities[entity_index(id)].mask.test(component_id));
+
+    if constexpr (std::is_empty_v<T>)
+      return tag_instance<T>;
+    else
+      return *reinterpret_cast<T *>(_component_pools[component_id]->get(id));
+  }
+
+  const component_mask_t &mask(entity_id_t id) const {
+    assert(valid(id));
+    return _entities[entity_index(id)].mask;
+  }
+
+  template <typename T, typename... args_t>
+  T &construct(entity_id_t id, args_t &&...args) {
+    assert(valid(id));
+    assert(!_entities[entity_index(id)].mask.test(get_component_id_for<T>()));
+
+    component_id_t component_id = get_component_id_for<T>();
+    entity_description_t &entity_description = _entities[entity_index(id)];
+    entity_description.mask.set(component_id);
+
+    pool_for_t<T, page_size> *pool = _assure_pool<T>();
+    T *component = pool->construct(id, std::forward<args_t>(args)...);
+    if (pool->group != nullptr) {
+      _join_group(id, pool);
+      // joining may have moved the component
+      component = reinterpret_cast<T *>(pool->get(id));
+    }
+    pool->on_construct.publish(*this, id);
+    return *component;
+  }
+
+  // constructs T for every entity in ids from copies of args, the components
+  // are written contiguously and the first one is returned. when T is owned
+  // by a group, joining reorders them and only the first one is meaningful
+  template <typename T, typename... args_t>
+  T *construct_n(std::span<const entity_id_t> ids, const args_t &...args) {
+    component_id_t component_id = get_component_id_for<T>();
+    for (entity_id_t id : ids) {
+      assert(valid(id));
+      assert(!_entities[entity_index(id)].mask.test(component_id));
+      _entities[entity_index(id)].mask.set(component_id);
+    }
+
+    pool_for_t<T, page_size> *pool = _assure_pool<T>();
+    T *first = pool->construct_n(ids, args...);
+    if (pool->group != nullptr) {
+      for (entity_id_t id : ids)
+        _join_group(id, pool);
+      first = reinterpret_cast<T *>(pool->get(ids.front()));
+    }
+
+    if (!pool->on_construct.empty())
+      for (entity_id_t id : ids)
+        pool->on_construct.publish(*this, id);
+    return first;
+  }
+
+  // runs every func(T &) on the component, then stamps it as changed this
+  // tick and fires on_update
+  template <typename T, typename... func_t>
+  T &patch(entity_id_t id, func_t &&...funcs) {
+    static_assert(sizeof...(func_t) > 0,
+                  "write through funcs, or use get and mark_changed");
+
+    T &component = get<T>(id);
+    (std::forward<func_t>(funcs)(component), ...);
+    mark_changed<T>(id);
+    return component;
+  }
+
+  // for writes made through get, stamps the component and fires on_update
+  template <typename T> void mark_changed(entity_id_t id) {
+    assert(valid(id));
+
+    component_id_t component_id = get_component_id_for<T>();
+    assert(_entities[entity_index(id)].mask.test(component_id));
+
+    base_component_pool_t<page_size> *pool = _component_pools[component_id];
+    if constexpr (!std::is_empty_v<T>)
+      pool->mark_changed(pool->dense_index_of(id));
+    pool->on_update.publish(*this, id);
+  }
+
+  // per component type sinks. construct, construct_n and clone_n fire
+  // on_construct once the component is in place, remove and destroy fire
+  // on_destroy while it is still there, patch and mark_changed fire on_update
+  template <typename T> signal_t<page_size> &on_construct() {
+    return _assure_pool<T>()->on_construct;
+  }
+
+  template <typename T> signal_t<page_size> &on_destroy() {
+    return _assure_pool<T>()->on_destroy;
+  }
+
+  template <typename T> signal_t<page_size> &on_update() {
+    return _assure_pool<T>()->on_update;
+  }
+
+  // starts logging the entities T is removed from, including destroyed ones
+  template <typename T> void track_removed(bool enable = true) {
+    base_component_pool_t<page_size> *pool = _assure_pool<T>();
+    pool->track_removed = enable;
+    if (!enable)
+      pool->removed_log.clear();
+  }
+
+  template <typename T> std::vector<entity_id_t> drain_removed() {
+    base_component_pool_t<page_size> *pool =
+        _try_pool(get_component_id_for<T>());
+    return pool ? pool->drain_removed() : std::vector<entity_id_t>{};
+  }
+
+  template <typename T> void remove(entity_id_t id) {
+    assert(valid(id));
+    assert(_entities[entity_index(id)].mask.test(get_component_id_for<T>()));
+
+    component_id_t component_id = get_component_id_for<T>();
+    _component_pools[component_id]->on_destroy.publish(*this, id);
+    _leave_group(id, _component_pools[component_id]);
+    _component_pools[component_id]->destroy(id);
+
+    entity_description_t &entity_description = _entities[entity_index(id)];
+    entity_description.mask.unset(component_id);
+  }
+
+  template <typename... T> bool has(entity_id_t id) {
+    assert(valid(id));
+
+    entity_description_t &entity_description = _entities[entity_index(id)];
+
+    return entity_description.mask.test_all(component_mask_of<T...>);
+  }
+
+  template <typename... T> void for_all(auto callback) {
+    if constexpr (sizeof...(T) == 0) {
+      for (auto &entity : _entities)
+        if (entity.is_valid) {
+          callback(entity.id);
+        }
+    } else {
+      view<T...>().each(callback);
+    }
+  }
+
+  template <typename... T, typename... X>
+  view_t<page_size, T...> view(exclude_t<X...> = {}) {
+    return view_t<page_size, T...>({_try_pool(get_component_id_for<T>())...},
+                                   this, component_mask_of<X...>);
+  }
+
+  // creates every involved pool up front so the query can hold on to them,
+  // keep the query around between frames to profit from the cache
+  template <typename... T, typename... X>
+  query_t<page_size, T...> query(exclude_t<X...> = {}) {
+    return query_t<page_size, T...>(
+        {_assure_pool<T>()..., _assure_pool<X>()...}, this,
+        component_mask_of<X...>,
+        &_structure_version);
+  }
+
+  // keeps a front copy of every T next to the live one. writers keep using
+  // get / views / patch on the live copy while readers such as render
+  // extraction use front<T>(), which only changes in swap_buffers. structural
+  // changes still belong to the sync point and apply to both copies.
+  template <typename T> void double_buffer(bool enable = true) {
+    static_assert(!std::is_empty_v<T>, "tags have no state to buffer");
+    static_assert(std::is_copy_assignable_v<T>,
+                  "double buffered components are copied to the front");
+
+    component_pool_t<T, page_size> *pool = _assure_pool<T>();
+    pool->double_buffer(enable);
+
+    auto it = std::find(_buffered_pools.begin(), _buffered_pools.end(), pool);
+    if (enable && it == _buffered_pools.end())
+      _buffered_pools.push_back(pool);
+    else if (!enable && it != _buffered_pools.end())
+      _buffered_pools.erase(it);
+  }
+
+  // frame boundary, publishes the live copy of every double buffered pool.
+  // must not run while anything reads a front copy
+  void swap_buffers() {
+    for (base_component_pool_t<page_size> *pool : _buffered_pools)
+      pool->copy_to_front();
+  }
+
+  template <typename T> const T &front(entity_id_t id) {
+    assert(valid(id));
+
+    auto *pool = static_cast<component_pool_t<T, page_size> *>(
+        _try_pool(get_component_id_for<T>()));
+    assert(pool != nullptr && pool->front && "T is not double buffered");
+    return (*pool->front)[pool->dense_index_of(id)];
+  }
+
+  // keeps a list of the entities tagged with T, tagged<T>() is empty until
+  // this is called
+  template <typename T>
+    requires std::is_empty_v<T>
+  void track_entities(bool enable = true) {
+    tag_pool_t<T, page_size> *pool = _assure_pool<T>();
+    if (pool->track_entities == enable)
+      return;
+
+    if (!enable) {
+      pool->clear_entities();
+      pool->track_entities = false;
+      return;
+    }
+
+    pool->track_entities = true;
+    component_id_t component_id = get_component_id_for<T>();
+    for (entity_description_t &entity : _entities)
+      if (entity.is_valid && entity.mask.test(component_id))
+        pool->construct(entity.id);
+  }
+
+  template <typename T>
+    requires std::is_empty_v<T>
+  std::span<const entity_id_t> tagged() {
+    base_component_pool_t<page_size> *pool =
+        _try_pool(get_component_id_for<T>());
+    if (pool == nullptr)
+      return {};
+    return pool->dense_index_to_entity_id;
+  }
+
+  // declares (on first use) and returns the owning group over T.... entities
+  // already holding every T are packed into it right away
+  template <typename... T> group_t<page_size, T...> group() {
+    static_assert((!std::is_empty_v<T> && ...), "tags cannot be grouped");
+
+    constexpr component_mask_t mask = component_mask_of<T...>;
+
+    std::tuple<component_pool_t<T, page_size> *...> pools{_assure_pool<T>()...};
+    group_data_t *data = std::get<0>(pools)->group;
+
+    if (data == nullptr) {
+      data = _groups.emplace_back(std::make_unique<group_data_t>()).get();
+      data->mask = mask;
+      data->component_ids = {get_component_id_for<T>()...};
+
+      std::apply(
+          [&](auto *...pool) {
+            ((assert(pool->group == nullptr &&
+                     "pool is already owned by another group"),
+              pool->group = data),
+             ...);
+          },
+          pools);
+
+      // walk a copy, joining reorders the dense array
+      std::vector<entity_id_t> candidates =
+          std::get<0>(pools)->dense_index_to_entity_id;
+      for (entity_id_t id : candidates)
+        _join_group(id, std::get<0>(pools));
+    }
+
+    assert(data->mask == mask && "group was declared with other components");
+    return group_t<page_size, T...>(pools, data);
+  }
+
+  // reorders the dense array of T by compare(const T &, const T &). for a
+  // pool owned by a group the group block and the rest are sorted separately
+  // and the block order is mirrored into the other owned pools.
+  template <typename T>
+  void sort(auto compare, sort_mode_t mode = sort_mode_t::full) {
+    static_assert(!std::is_empty_v<T>, "tags have nothing to sort");
+
+    component_id_t component_id = get_component_id_for<T>();
+    auto *pool =
+        static_cast<component_pool_t<T, page_size> *>(_try_pool(component_id));
+    if (pool == nullptr)
+      return;
+
+    auto less = [&](uint32_t a, uint32_t b) {
+      return compare(std::as_const(pool->dense[a]),
+                     std::as_const(pool->dense[b]));
+    };
+
+    if (group_data_t *group = pool->group) {
+      _sort_range(0, group->size, less, mode, group->component_ids);
+      _sort_range(group->size, pool->size(), less, mode, {&component_id, 1});
+    } else {
+      _sort_range(0, pool->size(), less, mode, {&component_id, 1});
+    }
+  }
+
+  // moves the entities of T that also own U to the front of T's pool, in the
+  // order they have in U's pool
+  template <typename T, typename U> void sort_as() {
+    static_assert(!std::is_same_v<T, U>);
+    static_assert(!std::is_empty_v<T>, "tags have nothing to sort");
+
+    base_component_pool_t<page_size> *pool =
+        _try_pool(get_component_id_for<T>());
+    base_component_pool_t<page_size> *other =
+        _try_pool(get_component_id_for<U>());
+    if (pool == nullptr || other == nullptr)
+      return;
+
+    assert(pool->group == nullptr && "sort the owning group instead");
+
+    uint32_t position = 0;
+    for (entity_id_t id : other->dense_index_to_entity_id)
+      if (pool->contains(id))
+        pool->swap_dense(pool->dense_index_of(id), position++);
+  }
+
+private:
+  friend class snapshot_t<page_size>;
+  friend class prefab_library_t<page_size>;
+
+  // ids already sit in every pool of mask, sets their masks, then joins the
+  // groups and fires on_construct like construct does
+  void _finish_clones(std::span<const entity_id_t> ids,
+                      const component_mask_t &mask) {
+    for (entity_id_t id : ids)
+      _entities[entity_index(id)].mask = mask;
+
+    mask.for_each_set([&](component_id_t component_id) {
+      for (entity_id_t id : ids)
+        _join_group(id, _component_pools[component_id]);
+    });
+    mask.for_each_set([&](component_id_t component_id) {
+      for (entity_id_t id : ids)
+        _component_pools[component_id]->on_construct.publish(*this, id);
+    });
+  }
+
+  // sorts the dense range [first, last) with less over dense indices and
+  // applies the resulting permutation to every pool in component_ids
+  void _sort_range(uint32_t first, uint32_t last, auto &less, sort_mode_t mode,
+                   std::span<const component_id_t> component_ids) {
+    if (last - first < 2)
+      return;
+
+    // order[i] is the dense index that ends up at first + i
+    std::vector<uint32_t> order(last - first);
+    for (uint32_t i = 0; i < order.size(); i++)
+      order[i] = first + i;
+
+    if (mode == sort_mode_t::full) {
+      std::sort(order.begin(), order.end(), less);
+    } else {
+      for (size_t i = 1; i < order.size(); i++) {
+        uint32_t value = order[i];
+        size_t j = i;
+        for (; j > 0 && less(value, order[j - 1]); j--)
+          order[j] = order[j - 1];
+        order[j] = value;
+      }
+    }
+
+    // walk every cycle of the permutation with swaps
+    for (uint32_t position = first; position < last; position++) {
+      uint32_t current = position;
+      while (order[current - first] != position) {
+        uint32_t next = order[current - first];
+        for (component_id_t component_id : component_ids)
+          _component_pools[component_id]->swap_dense(current, next);
+        order[current - first] = current;
+        current = next;
+      }
+      order[current - first] = current;
+    }
+  }
+
+  bool _in_group(entity_id_t id, const group_data_t *group) {
+    return _entities[entity_index(id)].mask.test_all(group->mask) &&
+           _component_pools[group->component_ids.front()]->dense_index_of(id) <
+               group->size;
+  }
+
+  // moves id to the end of the group block once it owns every grouped type
+  void _join_group(entity_id_t id, base_component_pool_t<page_size> *pool) {
+    group_data_t *group = pool->group;
+    if (group == nullptr ||
+        !_entities[entity_index(id)].mask.test_all(group->mask) ||
+        _in_group(id, group))
+      return;
+
+    for (component_id_t component_id : group->component_ids) {
+      base_component_pool_t<page_size> *owned = _component_pools[component_id];
+      owned->swap_dense(owned->dense_index_of(id), group->size);
+    }
+    ++group->size;
+  }
+
+  // moves id just past the group block, before one of its grouped components
+  // goes away
+  void _leave_group(entity_id_t id, base_component_pool_t<page_size> *pool) {
+    group_data_t *group = pool->group;
+    if (group == nullptr || !_in_group(id, group))
+      return;
+
+    --group->size;
+    for (component_id_t component_id : group->component_ids) {
+      base_component_pool_t<page_size> *owned = _component_pools[component_id];
+      owned->swap_dense(owned->dense_index_of(id), group->size);
+    }
+  }
+
+  base_component_pool_t<page_size> *_try_pool(component_id_t component_id) {
+    if (component_id >= _component_pools.size())
+      return nullptr;
+    return _component_pools[component_id];
+  }
+
+  // pool of the same type as pool, which belongs to another scene
+  base_component_pool_t<page_size> *
+  _assure_pool_like(const base_component_pool_t<page_size> &pool) {
+    if (_component_pools.size() <= pool._id)
+      _component_pools.resize(pool._id + 1, nullptr);
+
+    if (_component_pools[pool._id] == nullptr)
+      _component_pools[pool._id] =
+          pool.create_empty(&_tick, &_structure_version);
+
+    return _component_pools[pool._id];
+  }
+
+  template <typename T> pool_for_t<T, page_size> *_assure_pool() {
+    component_id_t component_id = get_component_id_for<T>();
+    if (_component_pools.size() <= component_id)
+      _component_pools.resize(component_id + 1, nullptr);
+
+    if (_component_pools[component_id] == nullptr)
+      _component_pools[component_id] = new pool_for_t<T, page_size>(
+          component_id, &_tick, &_structure_version);
+
+    return static_cast<pool_for_t<T, page_size> *>(
+        _component_pools[component_id]);
+  }
+
+  std::vector<entity_description_t> _entities;
+  entity_index_t _free_head = invalid_index;
+  uint32_t _alive = 0;
+  tick_t _tick = 1;
+  uint64_t _structure_version = 0;
+  std::vector<base_component_pool_t<page_size> *> _buffered_pools;
+  // indexed by component id
+  std::vector<base_component_pool_t<page_size> *> _component_pools;
+  std::vector<std::unique_ptr<group_data_t>> _groups;
+};
+
+// records structural changes (create, destroy, add, remove) so they can be
+// issued while iterating or from a job and applied later at a sync point.
+// entities created through the buffer get placeholder ids that only mean
+// something to commands of the same buffer until playback maps them to real
+// entities. a buffer is not thread safe, give every thread its own.
+template <size_t page_size = 2048> class command_buffer_t {
+  using scene_type = scene_t<page_size>;
+
+  struct component_ops_t {
+    // moves the payload into the scene (replacing an existing component) and
+    // destroys it
+    void (*add)(scene_type &scene, entity_id_t id, void *payload);
+    void (*remove)(scene_type &scene, entity_id_t id);
+    void (*drop)(void *payload);
+  };
+
+  enum class command_type_t : uint8_t { add, remove, destroy };
+
+  struct command_t {
+    entity_id_t entity;
+    const component_ops_t *ops;
+    void *payload;
+    component_id_t component_id;
+    command_type_t type;
+  };
+
+  struct block_t {
+    std::unique_ptr<std::byte[]> data;
+    size_t size;
+  };
+
+  static constexpr entity_generation_t placeholder_generation =
+      std::numeric_limits<entity_generation_t>::max();
+  static constexpr size_t block_size = 4096;
+
+public:
+  command_buffer_t() = default;
+  command_buffer_t(command_buffer_t &&) = default;
+  command_buffer_t &operator=(command_buffer_t &&) = delete;
+
+  ~command_buffer_t() { clear(); }
+
+  entity_id_t create() {
+    return make_entity_id(_created++, placeholder_generation);
+  }
+
+  void destroy(entity_id_t id) {
+    _commands.push_back({.entity = id,
+                         .ops = nullptr,
+                         .payload = nullptr,
+                         .component_id = 0,
+                         .type = command_type_t::destroy});
+  }
+
+  template <typename T, typename... args_t>
+  void emplace(entity_id_t id, args_t &&...args) {
+    void *payload = _allocate(sizeof(T), alignof(T));
+    new (payload) T{std::forward<args_t>(args)...};
+    _commands.push_back({.entity = id,
+                         .ops = &_ops<T>,
+                         .payload = payload,
+                         .component_id = component_id_of<T>,
+                         .type = command_type_t::add});
+  }
+
+  template <typename T> void remove(entity_id_t id) {
+    _commands.push_back({.entity = id,
+                         .ops = &_ops<T>,
+                         .payload = nullptr,
+                         .component_id = component_id_of<T>,
+                         .type = command_type_t::remove});
+  }
+
+  bool empty() const { return _commands.empty() && _created == 0; }
+
+  // applies and clears the buffer. placeholder entities are created first in
+  // one batch, then adds and removes run grouped by component type (each
+  // entity keeps its recorded order within a type), destroys run last.
+  // commands for entities that are no longer valid are dropped.
+  void playback(scene_type &scene) {
+    std::vector<entity_id_t> created = scene.create_n(_created);
+    auto resolve = [&](entity_id_t id) {
+      return entity_generation(id) == placeholder_generation
+                 ? created[entity_index(id)]
+                 : id;
+    };
+
+    std::vector<uint32_t> order;
+    order.reserve(_commands.size());
+    for (uint32_t i = 0; i < _commands.size(); i++)
+      if (_commands[i].type != command_type_t::destroy)
+        order.push_back(i);
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return _commands[a].component_id < _commands[b].component_id;
+    });
+
+    for (uint32_t i : order) {
+      command_t &command = _commands[i];
+      entity_id_t id = resolve(command.entity);
+      bool valid = scene.valid(id);
+
+      if (command.type == command_type_t::add) {
+        if (valid)
+          command.ops->add(scene, id, command.payload);
+        else
+          command.ops->drop(command.payload);
+        command.payload = nullptr;
+      } else if (valid) {
+        command.ops->remove(scene, id);
+      }
+    }
+
+    for (const command_t &command : _commands) {
+      entity_id_t id = resolve(command.entity);
+      if (command.type == command_type_t::destroy && scene.valid(id))
+        scene.destroy(id);
+    }
+
+    clear();
+  }
+
+  // drops every recorded command without applying it
+  void clear() {
+    for (command_t &command : _commands)
+      if (command.type == command_type_t::add && command.payload != nullptr)
+        command.ops->drop(command.payload);
+
+    _commands.clear();
+    _created = 0;
+    _block_index = 0;
+    _block_used = 0;
+  }
+
+private:
+  template <typename T>
+  static constexpr component_ops_t _ops = {
+      .add =
+          [](scene_type &scene, entity_id_t id, void *payload) {
+            T &component = *static_cast<T *>(payload);
+            if (scene.template has<T>(id))
+              scene.template patch<T>(
+                  id, [&](T &current) { current = std::move(component); });
+            else
+              scene.template construct<T>(id, std::move(component));
+            std::destroy_at(&component);
+          },
+      .remove =
+          [](scene_type &scene, entity_id_t id) {
+            if (scene.template has<T>(id))
+              scene.template remove<T>(id);
+          },
+      .drop = [](void *payload) { std::destroy_at(static_cast<T *>(payload)); },
+  };
+
+  // payloads live in blocks that never move, blocks are reused after a clear
+  void *_allocate(size_t size, size_t alignment) {
+    while (true) {
+      if (_block_index == _blocks.size()) {
+        size_t new_size = std::max(block_size, size + alignment);
+        _blocks.push_back({std::make_unique<std::byte[]>(new_size), new_size});
+      }
+
+      block_t &block = _blocks[_block_index];
+      uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+      size_t offset =
+          ((base + _block_used + alignment - 1) & ~(alignment - 1)) - base;
+
+      if (offset + size <= block.size) {
+        _block_used = offset + size;
+        return block.data.get() + offset;
+      }
+
+      ++_block_index;
+      _block_used = 0;
+    }
+  }
+
+  std::vector<command_t> _commands;
+  entity_index_t _created = 0;
+
+  std::vector<block_t> _blocks;
+  size_t _block_index = 0;
+  size_t _block_used = 0;
+};
+
+// one command buffer per thread of a job system, jobs record into local()
+// and the owner plays every buffer back at a sync point. threads outside the
+// job system share buffer 0, so only one of them should record at a time.
+template <size_t page_size = 2048> class thread_command_buffers_t {
+public:
+  explicit thread_command_buffers_t(
+      core::job_system_t &job_system = core::job_system_t::getInstance())
+      : _job_system(job_system), _buffers(job_system.threadCount()) {}
+
+  command_buffer_t<page_size> &local() {
+    return _buffers[_job_system.threadIndex()];
+  }
+
+  // buffers are applied in thread order, so playback is deterministic for a
+  // deterministic split of work
+  void playback(scene_t<page_size> &scene) {
+    for (command_buffer_t<page_size> &buffer : _buffers)
+      if (!buffer.empty())
+        buffer.playback(scene);
+  }
+
+private:
+  core::job_system_t &_job_system;
+  std::vector<command_buffer_t<page_size>> _buffers;
 };
 
 } // namespace ecs
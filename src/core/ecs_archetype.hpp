@@ -0,0 +1,462 @@
+#ifndef ECS_ARCHETYPE_HPP
+#define ECS_ARCHETYPE_HPP
+
+#include "core/ecs.hpp"
+
+#include <algorithm>
+#include <new>
+#include <tuple>
+
+namespace ecs {
+
+// archetype storage backend, an alternative to the sparse set pools in scene_t.
+// entities sharing the same component mask live together in fixed size chunks,
+// every chunk is laid out as SoA: [entity ids][component a][component b]...
+// so iterating several components is a linear walk over the matching chunks.
+// it only covers the entity and component basics (create, destroy, construct,
+// get, has, remove, for_all) for benchmarking both layouts on the same data.
+// views, groups, queries, signals and snapshots exist on scene_t only, so it is
+// not a drop-in replacement and worlds always run on scene_t.
+
+// type erased operations needed to relocate a component between chunks
+struct component_info_t {
+  uint32_t size = 0;
+  uint32_t alignment = 0;
+  void (*move_construct)(void *dst, void *src) = nullptr;
+  void (*destroy)(void *ptr) = nullptr;
+};
+
+template <typename T> component_info_t make_component_info() {
+  component_info_t info{};
+  info.size = sizeof(T);
+  info.alignment = alignof(T);
+  info.move_construct = [](void *dst, void *src) {
+    new (dst) T(std::move(*static_cast<T *>(src)));
+  };
+  info.destroy = [](void *ptr) { static_cast<T *>(ptr)->~T(); };
+  return info;
+}
+
+static constexpr size_t chunk_alignment = 64;
+
+struct chunk_t {
+  chunk_t(size_t bytes)
+      : data(static_cast<uint8_t *>(
+            ::operator new(bytes, std::align_val_t{chunk_alignment}))) {}
+
+  chunk_t(const chunk_t &) = delete;
+  chunk_t &operator=(const chunk_t &) = delete;
+
+  chunk_t(chunk_t &&other) noexcept : data(other.data) { other.data = nullptr; }
+  chunk_t &operator=(chunk_t &&other) noexcept {
+    std::swap(data, other.data);
+    return *this;
+  }
+
+  ~chunk_t() {
+    if (data)
+      ::operator delete(data, std::align_val_t{chunk_alignment});
+  }
+
+  uint8_t *data = nullptr;
+};
+
+struct archetype_t {
+  component_mask_t mask;
+  // sorted, parallel to column_offsets
+  std::vector<component_id_t> component_ids;
+  std::vector<uint32_t> column_offsets;
+  // component id -> column, invalid_index if the archetype lacks it
+  std::vector<uint32_t> column_of;
+  // component id -> archetype reached by adding / removing that component
+  std::vector<uint32_t> add_edges;
+  std::vector<uint32_t> remove_edges;
+
+  uint32_t capacity = 0; // rows per chunk
+  size_t chunk_bytes = 0;
+  uint32_t entity_count = 0;
+  // every chunk is full except the last one
+  std::vector<chunk_t> chunks;
+
+  uint32_t column_index(component_id_t component_id) const {
+    if (component_id >= column_of.size())
+      return invalid_index;
+    return column_of[component_id];
+  }
+
+  entity_id_t *entities(uint32_t chunk_index) {
+    return reinterpret_cast<entity_id_t *>(chunks[chunk_index].data);
+  }
+
+  void *component(uint32_t column, uint32_t row, uint32_t size) {
+    chunk_t &chunk = chunks[row / capacity];
+    return chunk.data + column_offsets[column] + (row % capacity) * size;
+  }
+
+  uint32_t rows_in_chunk(uint32_t chunk_index) const {
+    return std::min(capacity, entity_count - chunk_index * capacity);
+  }
+};
+
+template <size_t chunk_size = 16384> class archetype_scene_t {
+  // dead records keep the next free slot in the index part of their id, see
+  // scene_t
+  struct entity_record_t {
+    entity_id_t id;
+    uint32_t archetype;
+    uint32_t row;
+    bool is_valid;
+  };
+
+public:
+  archetype_scene_t(entity_id_t reserved_entities = 1000) {
+    _entities.reserve(reserved_entities);
+    // archetype 0 holds entities without any component
+    _archetypes.emplace_back();
+    _layout(_archetypes[0]);
+  }
+
+  ~archetype_scene_t() {
+    for (auto &archetype : _archetypes)
+      for (uint32_t row = 0; row < archetype.entity_count; row++)
+        for (uint32_t c = 0; c < archetype.component_ids.size(); c++) {
+          const component_info_t &info =
+              _component_infos[archetype.component_ids[c]];
+          info.destroy(archetype.component(c, row, info.size));
+        }
+  }
+
+  archetype_scene_t(const archetype_scene_t &) = delete;
+  archetype_scene_t &operator=(const archetype_scene_t &) = delete;
+
+  template <typename T> static component_id_t get_component_id_for() {
+    return component_id_of<T>;
+  }
+
+  entity_id_t create() {
+    entity_index_t index;
+    if (_free_head == invalid_index) {
+      assert(_entities.size() < invalid_index);
+      index = static_cast<entity_index_t>(_entities.size());
+      _entities.push_back({.id = make_entity_id(index, 0),
+                           .archetype = 0,
+                           .row = 0,
+                           .is_valid = false});
+    } else {
+      index = _free_head;
+      _free_head = entity_index(_entities[index].id);
+    }
+
+    entity_record_t &record = _entities[index];
+    assert(!record.is_valid);
+    record.id = make_entity_id(index, entity_generation(record.id));
+    record.archetype = 0;
+    record.row = _push_row(_archetypes[0], record.id);
+    record.is_valid = true;
+    ++_alive;
+
+    return record.id;
+  }
+
+  void destroy(entity_id_t id) {
+    assert(valid(id));
+
+    entity_record_t &record = _entities[entity_index(id)];
+    _remove_row(_archetypes[record.archetype], record.row);
+    record.is_valid = false;
+    record.id = make_entity_id(_free_head, entity_generation(id) + 1);
+    _free_head = entity_index(id);
+    --_alive;
+  }
+
+  bool valid(entity_id_t id) const {
+    entity_index_t index = entity_index(id);
+    return id != null_entity_id && index < _entities.size() &&
+           _entities[index].is_valid && _entities[index].id == id;
+  }
+
+  void reserve(uint32_t entity_count) { _entities.reserve(entity_count); }
+
+  uint32_t alive() const { return _alive; }
+
+  template <typename T> T &get(entity_id_t id) {
+    assert(valid(id));
+
+    component_id_t component_id = get_component_id_for<T>();
+    entity_record_t &record = _entities[entity_index(id)];
+    archetype_t &archetype = _archetypes[record.archetype];
+    uint32_t column = archetype.column_index(component_id);
+
+    assert(column != invalid_index);
+
+    return *reinterpret_cast<T *>(
+        archetype.component(column, record.row, sizeof(T)));
+  }
+
+  template <typename T, typename... args_t>
+  T &construct(entity_id_t id, args_t &&...args) {
+    assert(valid(id));
+
+    component_id_t component_id = _register_component<T>();
+    entity_record_t &record = _entities[entity_index(id)];
+    assert(!_archetypes[record.archetype].mask.test(component_id));
+
+    uint32_t target = _add_edge(record.archetype, component_id);
+    _move_entity(id, target);
+
+    archetype_t &archetype = _archetypes[target];
+    void *component = archetype.component(
+        archetype.column_index(component_id), record.row, sizeof(T));
+
+    return *(new (component) T{std::forward<args_t>(args)...});
+  }
+
+  template <typename T> void remove(entity_id_t id) {
+    assert(valid(id));
+
+    component_id_t component_id = get_component_id_for<T>();
+    entity_record_t &record = _entities[entity_index(id)];
+    assert(_archetypes[record.archetype].mask.test(component_id));
+
+    uint32_t target = _remove_edge(record.archetype, component_id);
+    _move_entity(id, target);
+  }
+
+  template <typename... T> bool has(entity_id_t id) {
+    assert(valid(id));
+
+    const entity_record_t &record = _entities[entity_index(id)];
+    return _archetypes[record.archetype].mask.test_all(
+        component_mask_of<T...>);
+  }
+
+  template <typename... T> void for_all(auto callback) {
+    if constexpr (sizeof...(T) == 0) {
+      for (auto &entity : _entities)
+        if (entity.is_valid) {
+          callback(entity.id);
+        }
+    } else {
+      constexpr component_mask_t mask = component_mask_of<T...>;
+      constexpr component_id_t component_ids[] = {component_id_of<T>...};
+      for (auto &archetype : _archetypes) {
+        if (archetype.entity_count == 0 || !archetype.mask.test_all(mask))
+          continue;
+
+        uint32_t columns[sizeof...(T)];
+        for (uint32_t i = 0; i < sizeof...(T); i++)
+          columns[i] = archetype.column_index(component_ids[i]);
+
+        for (uint32_t c = 0; c < archetype.chunks.size(); c++)
+          _for_chunk<T...>(archetype, c, columns, callback,
+                           std::index_sequence_for<T...>{});
+      }
+    }
+  }
+
+  uint32_t archetype_count() const {
+    return static_cast<uint32_t>(_archetypes.size());
+  }
+
+private:
+  // components get their relocation info the first time this scene stores them
+  template <typename T> component_id_t _register_component() {
+    component_id_t component_id = get_component_id_for<T>();
+    if (_component_infos.size() <= component_id)
+      _component_infos.resize(component_id + 1);
+    if (_component_infos[component_id].size == 0)
+      _component_infos[component_id] = make_component_info<T>();
+    return component_id;
+  }
+
+  template <typename... T, size_t... I>
+  void _for_chunk(archetype_t &archetype, uint32_t chunk_index,
+                  const uint32_t *columns, auto &callback,
+                  std::index_sequence<I...>) {
+    uint8_t *data = archetype.chunks[chunk_index].data;
+    entity_id_t *entities = archetype.entities(chunk_index);
+    std::tuple<T *...> arrays{
+        reinterpret_cast<T *>(data + archetype.column_offsets[columns[I]])...};
+
+    uint32_t count = archetype.rows_in_chunk(chunk_index);
+    for (uint32_t row = 0; row < count; row++)
+      callback(entities[row], std::get<I>(arrays)[row]...);
+  }
+
+  // computes the chunk capacity and column offsets for the archetype
+  void _layout(archetype_t &archetype) {
+    uint32_t row_bytes = sizeof(entity_id_t);
+    for (component_id_t component_id : archetype.component_ids) {
+      assert(_component_infos[component_id].alignment <= chunk_alignment);
+      row_bytes += _component_infos[component_id].size;
+    }
+
+    auto bytes_for = [&](uint32_t capacity) {
+      size_t offset = sizeof(entity_id_t) * capacity;
+      archetype.column_offsets.clear();
+      for (component_id_t component_id : archetype.component_ids) {
+        const component_info_t &info = _component_infos[component_id];
+        offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+        archetype.column_offsets.push_back(static_cast<uint32_t>(offset));
+        offset += static_cast<size_t>(info.size) * capacity;
+      }
+      return offset;
+    };
+
+    uint32_t capacity = std::max<uint32_t>(1, chunk_size / row_bytes);
+    while (capacity > 1 && bytes_for(capacity) > chunk_size)
+      --capacity;
+
+    archetype.capacity = capacity;
+    archetype.chunk_bytes = std::max(chunk_size, bytes_for(capacity));
+  }
+
+  uint32_t _find_or_create_archetype(const component_mask_t &mask,
+                                     std::vector<component_id_t> ids) {
+    for (uint32_t i = 0; i < _archetypes.size(); i++)
+      if (_archetypes[i].mask == mask)
+        return i;
+
+    std::sort(ids.begin(), ids.end());
+
+    archetype_t archetype{};
+    archetype.mask = mask;
+    archetype.component_ids = std::move(ids);
+    archetype.column_of.assign(_component_infos.size(), invalid_index);
+    for (uint32_t c = 0; c < archetype.component_ids.size(); c++)
+      archetype.column_of[archetype.component_ids[c]] = c;
+    _layout(archetype);
+
+    _archetypes.push_back(std::move(archetype));
+    return static_cast<uint32_t>(_archetypes.size() - 1);
+  }
+
+  uint32_t _add_edge(uint32_t source, component_id_t component_id) {
+    std::vector<uint32_t> &edges = _archetypes[source].add_edges;
+    if (component_id < edges.size() && edges[component_id] != invalid_index)
+      return edges[component_id];
+
+    component_mask_t mask = _archetypes[source].mask;
+    mask.set(component_id);
+    std::vector<component_id_t> ids = _archetypes[source].component_ids;
+    ids.push_back(component_id);
+
+    uint32_t target = _find_or_create_archetype(mask, std::move(ids));
+
+    std::vector<uint32_t> &source_edges = _archetypes[source].add_edges;
+    if (source_edges.size() <= component_id)
+      source_edges.resize(component_id + 1, invalid_index);
+    source_edges[component_id] = target;
+
+    std::vector<uint32_t> &target_edges = _archetypes[target].remove_edges;
+    if (target_edges.size() <= component_id)
+      target_edges.resize(component_id + 1, invalid_index);
+    target_edges[component_id] = source;
+
+    return target;
+  }
+
+  uint32_t _remove_edge(uint32_t source, component_id_t component_id) {
+    std::vector<uint32_t> &edges = _archetypes[source].remove_edges;
+    if (component_id < edges.size() && edges[component_id] != invalid_index)
+      return edges[component_id];
+
+    component_mask_t mask = _archetypes[source].mask;
+    mask.unset(component_id);
+    std::vector<component_id_t> ids = _archetypes[source].component_ids;
+    ids.erase(std::find(ids.begin(), ids.end(), component_id));
+
+    uint32_t target = _find_or_create_archetype(mask, std::move(ids));
+
+    std::vector<uint32_t> &source_edges = _archetypes[source].remove_edges;
+    if (source_edges.size() <= component_id)
+      source_edges.resize(component_id + 1, invalid_index);
+    source_edges[component_id] = target;
+
+    std::vector<uint32_t> &target_edges = _archetypes[target].add_edges;
+    if (target_edges.size() <= component_id)
+      target_edges.resize(component_id + 1, invalid_index);
+    target_edges[component_id] = source;
+
+    return target;
+  }
+
+  uint32_t _push_row(archetype_t &archetype, entity_id_t id) {
+    uint32_t row = archetype.entity_count;
+    if (row / archetype.capacity >= archetype.chunks.size())
+      archetype.chunks.emplace_back(archetype.chunk_bytes);
+
+    archetype.entities(row / archetype.capacity)[row % archetype.capacity] = id;
+    ++archetype.entity_count;
+    return row;
+  }
+
+  // destroys the components at row and fills the hole with the last row
+  void _remove_row(archetype_t &archetype, uint32_t row) {
+    uint32_t top_row = archetype.entity_count - 1;
+
+    for (uint32_t c = 0; c < archetype.component_ids.size(); c++) {
+      const component_info_t &info =
+          _component_infos[archetype.component_ids[c]];
+      info.destroy(archetype.component(c, row, info.size));
+    }
+
+    if (row != top_row) {
+      for (uint32_t c = 0; c < archetype.component_ids.size(); c++) {
+        const component_info_t &info =
+            _component_infos[archetype.component_ids[c]];
+        void *top = archetype.component(c, top_row, info.size);
+        info.move_construct(archetype.component(c, row, info.size), top);
+        info.destroy(top);
+      }
+
+      entity_id_t top_id = archetype.entities(
+          top_row / archetype.capacity)[top_row % archetype.capacity];
+      archetype.entities(row / archetype.capacity)[row % archetype.capacity] =
+          top_id;
+      _entities[entity_index(top_id)].row = row;
+    }
+
+    --archetype.entity_count;
+
+    if (archetype.entity_count <=
+        (archetype.chunks.size() - 1) * archetype.capacity)
+      archetype.chunks.pop_back();
+  }
+
+  // moves the entity and every component shared by both archetypes
+  void _move_entity(entity_id_t id, uint32_t target) {
+    entity_record_t &record = _entities[entity_index(id)];
+    archetype_t &source_archetype = _archetypes[record.archetype];
+    archetype_t &target_archetype = _archetypes[target];
+
+    uint32_t row = _push_row(target_archetype, id);
+
+    for (uint32_t c = 0; c < target_archetype.component_ids.size(); c++) {
+      component_id_t component_id = target_archetype.component_ids[c];
+      uint32_t source_column = source_archetype.column_index(component_id);
+      if (source_column == invalid_index)
+        continue;
+
+      const component_info_t &info = _component_infos[component_id];
+      info.move_construct(
+          target_archetype.component(c, row, info.size),
+          source_archetype.component(source_column, record.row, info.size));
+    }
+
+    _remove_row(source_archetype, record.row);
+
+    record.archetype = target;
+    record.row = row;
+  }
+
+  std::vector<entity_record_t> _entities;
+  entity_index_t _free_head = invalid_index;
+  uint32_t _alive = 0;
+  std::vector<archetype_t> _archetypes;
+  // indexed by component id
+  std::vector<component_info_t> _component_infos;
+};
+
+} // namespace ecs
+#endif
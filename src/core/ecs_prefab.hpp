@@ -0,0 +1,74 @@
+#ifndef ECS_PREFAB_HPP
+#define ECS_PREFAB_HPP
+
+#include "core/ecs.hpp"
+
+namespace ecs {
+
+// prefabs are template entities kept in a side scene, so they never show up in
+// views or groups of the game scene. instantiate spawns count copies of a
+// prefab as one batch: the ids are created at once and every pool is filled
+// in a single pass, trivially copyable components by memcpy. components that
+// hold assets by shared handle (models) only copy the handles, components that
+// cannot be copied at all are left out of the instances.
+template <size_t page_size = 2048> class prefab_library_t {
+  using scene_type = scene_t<page_size>;
+  using pool_t = base_component_pool_t<page_size>;
+
+public:
+  entity_id_t create() { return _templates.create(); }
+  void destroy(entity_id_t prefab) { _templates.destroy(prefab); }
+  bool valid(entity_id_t prefab) const { return _templates.valid(prefab); }
+
+  // the side scene, components are added to a prefab through it
+  scene_type &templates() { return _templates; }
+
+  std::vector<entity_id_t> instantiate(scene_type &scene, entity_id_t prefab,
+                                       uint32_t count) {
+    std::vector<entity_id_t> ids = scene.create_n(count);
+    component_mask_t mask =
+        _copy_components(scene, prefab, _templates.mask(prefab), ids);
+    scene._finish_clones(ids, mask);
+    return ids;
+  }
+
+  // spawns values.size() copies, instance i gets values[i] as its T (usually
+  // the transform) instead of the one of the prefab
+  template <typename T>
+  std::vector<entity_id_t> instantiate(scene_type &scene, entity_id_t prefab,
+                                       std::span<const T> values) {
+    static_assert(!std::is_empty_v<T>, "tags carry no per instance values");
+
+    std::vector<entity_id_t> ids =
+        scene.create_n(static_cast<uint32_t>(values.size()));
+    component_id_t component_id =
+        scene_type::template get_component_id_for<T>();
+    component_mask_t mask = _templates.mask(prefab);
+    mask.unset(component_id);
+    mask = _copy_components(scene, prefab, mask, ids);
+
+    scene.template _assure_pool<T>()->append_n(ids, values.data());
+    mask.set(component_id);
+    scene._finish_clones(ids, mask);
+    return ids;
+  }
+
+private:
+  // returns mask without the components that could not be copied
+  component_mask_t _copy_components(scene_type &scene, entity_id_t prefab,
+                                    const component_mask_t &mask,
+                                    std::span<const entity_id_t> ids) {
+    component_mask_t copied = mask;
+    mask.for_each_set([&](component_id_t component_id) {
+      pool_t *source = _templates._component_pools[component_id];
+      if (!scene._assure_pool_like(*source)->copy_n(*source, prefab, ids))
+        copied.unset(component_id);
+    });
+    return copied;
+  }
+
+  scene_type _templates;
+};
+
+} // namespace ecs
+#endif
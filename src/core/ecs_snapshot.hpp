@@ -0,0 +1,580 @@
+#ifndef ECS_SNAPSHOT_HPP
+#define ECS_SNAPSHOT_HPP
+
+#include "core/ecs.hpp"
+#include "core/mapped_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ecs {
+
+// binary scene snapshot, native endianness. every block starts on a
+// snapshot_alignment boundary so a mapped file can be read in place.
+//
+//   header
+//   entity ids        entity_id_t[entity_count]
+//   entity validity   uint8_t[entity_count]
+//   per pool:         records, entity ids, page headers, page data
+//   pool table        snapshot_pool_t[pool_count]
+//   string table      referenced by snapshot_string_t offsets
+//
+// pools are matched by component_type_hash, so a file only loads into builds
+// from the same compiler that know the component type.
+static constexpr uint32_t snapshot_magic = 0x4e534345; // "ECSN"
+static constexpr uint32_t snapshot_version = 1;
+static constexpr size_t snapshot_alignment = 64;
+
+enum snapshot_flags_t : uint32_t {
+  // records are the components themselves and are copied as one block
+  snapshot_trivially_copyable = 1 << 0,
+};
+
+struct snapshot_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t page_size;
+  uint32_t entity_count;
+  uint32_t free_head;
+  uint32_t alive;
+  tick_t tick;
+  uint32_t pool_count;
+  uint64_t entity_ids_offset;
+  uint64_t entity_valid_offset;
+  uint64_t pools_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+};
+
+struct snapshot_pool_t {
+  uint64_t type_hash;
+  uint32_t flags;
+  uint32_t record_size;
+  uint32_t count;
+  uint32_t page_count;
+  uint64_t records_offset;
+  uint64_t entities_offset;
+  // snapshot_page_t[page_count], then page_count pages of page_size indices
+  uint64_t page_headers_offset;
+  uint64_t page_data_offset;
+};
+
+struct snapshot_page_t {
+  uint32_t page_index;
+  uint32_t live_count;
+};
+
+// reference into the string table
+struct snapshot_string_t {
+  uint32_t offset;
+  uint32_t size;
+};
+
+// collects the string table while saving, equal strings are stored once
+class snapshot_string_writer_t {
+public:
+  snapshot_string_t add(std::string_view string) {
+    auto it = _offsets.find(std::string(string));
+    if (it != _offsets.end())
+      return {it->second, static_cast<uint32_t>(string.size())};
+
+    uint32_t offset = static_cast<uint32_t>(_data.size());
+    _data.insert(_data.end(), string.begin(), string.end());
+    _offsets.emplace(std::string(string), offset);
+    return {offset, static_cast<uint32_t>(string.size())};
+  }
+
+  const std::string &data() const { return _data; }
+
+private:
+  std::string _data;
+  std::unordered_map<std::string, uint32_t> _offsets;
+};
+
+// views into the string table of a mapped snapshot, valid during load only
+class snapshot_string_reader_t {
+public:
+  snapshot_string_reader_t(const char *data, size_t size)
+      : _data(data), _size(size) {}
+
+  std::string_view get(snapshot_string_t string) const {
+    if (string.offset > _size || string.size > _size - string.offset)
+      return {};
+    return {_data + string.offset, string.size};
+  }
+
+private:
+  const char *_data;
+  size_t _size;
+};
+
+// saves and loads scenes for the registered component types, pools of other
+// types are skipped. trivially copyable components are stored as is, any
+// other type goes through a trivially copyable record type and a pair of
+// conversion functions (strings and asset paths via the string table).
+template <size_t page_size = 2048> class snapshot_t {
+  using scene_type = scene_t<page_size>;
+  using pool_t = base_component_pool_t<page_size>;
+
+  struct entry_t {
+    uint64_t type_hash;
+    component_id_t component_id;
+    uint32_t record_size;
+    uint32_t flags;
+    // conversion functions of non trivially copyable types, cast back to
+    // their real type by the save / load thunks
+    void (*to_record)();
+    void (*from_record)();
+    void (*save)(const entry_t &entry, pool_t *pool, std::string &records,
+                 snapshot_string_writer_t &strings);
+    void (*load)(const entry_t &entry, scene_type &scene,
+                 const std::byte *records, uint32_t count,
+                 const snapshot_string_reader_t &strings);
+  };
+
+public:
+  template <typename T> void register_component() {
+    static_assert(!std::is_empty_v<T>, "tags are not stored in snapshots");
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "register a record type and conversions for this component");
+
+    _entries.push_back({
+        .type_hash = component_type_hash<T>(),
+        .component_id = component_id_of<T>,
+        .record_size = sizeof(T),
+        .flags = snapshot_trivially_copyable,
+        .to_record = nullptr,
+        .from_record = nullptr,
+        .save = &_save_trivial<T>,
+        .load = &_load_trivial<T>,
+    });
+  }
+
+  template <typename T, typename record_t>
+  void register_component(
+      record_t (*to_record)(const T &, snapshot_string_writer_t &),
+      T (*from_record)(const record_t &, const snapshot_string_reader_t &)) {
+    static_assert(std::is_trivially_copyable_v<record_t>);
+
+    _entries.push_back({
+        .type_hash = component_type_hash<T>(),
+        .component_id = component_id_of<T>,
+        .record_size = sizeof(record_t),
+        .flags = 0,
+        .to_record = reinterpret_cast<void (*)()>(to_record),
+        .from_record = reinterpret_cast<void (*)()>(from_record),
+        .save = &_save_records<T, record_t>,
+        .load = &_load_records<T, record_t>,
+    });
+  }
+
+  bool save(scene_type &scene, const std::filesystem::path &path) const {
+    std::string file(sizeof(snapshot_header_t), '\0');
+    snapshot_header_t header{};
+    header.magic = snapshot_magic;
+    header.version = snapshot_version;
+    header.page_size = static_cast<uint32_t>(page_size);
+    header.entity_count = static_cast<uint32_t>(scene._entities.size());
+    header.free_head = scene._free_head;
+    header.alive = scene._alive;
+    header.tick = scene._tick;
+
+    std::vector<entity_id_t> entity_ids(header.entity_count);
+    std::vector<uint8_t> entity_valid(header.entity_count);
+    for (uint32_t i = 0; i < header.entity_count; i++) {
+      entity_ids[i] = scene._entities[i].id;
+      entity_valid[i] = scene._entities[i].is_valid;
+    }
+    header.entity_ids_offset = _write_block(
+        file, entity_ids.data(), entity_ids.size() * sizeof(entity_id_t));
+    header.entity_valid_offset =
+        _write_block(file, entity_valid.data(), entity_valid.size());
+
+    snapshot_string_writer_t strings;
+    std::vector<snapshot_pool_t> pools;
+    std::vector<std::pair<const entry_t *, pool_t *>> saved;
+
+    for (const entry_t &entry : _entries) {
+      pool_t *pool = scene._try_pool(entry.component_id);
+      if (pool != nullptr && pool->size() > 0)
+        saved.emplace_back(&entry, pool);
+    }
+
+    // the pool table is written after the pool blocks, once offsets are known
+    for (auto [entry, pool] : saved) {
+      snapshot_pool_t record{};
+      record.type_hash = entry->type_hash;
+      record.flags = entry->flags;
+      record.record_size = entry->record_size;
+      record.count = pool->size();
+
+      std::string records;
+      entry->save(*entry, pool, records, strings);
+      record.records_offset =
+          _write_block(file, records.data(), records.size());
+      record.entities_offset =
+          _write_block(file, pool->dense_index_to_entity_id.data(),
+                       record.count * sizeof(entity_id_t));
+
+      std::vector<snapshot_page_t> page_headers;
+      std::vector<uint32_t> page_data;
+      for (uint32_t page_index = 0; page_index < pool->page_live_counts.size();
+           page_index++) {
+        if (!pool->sparse.check_if_value_exist(page_index))
+          continue;
+
+        const auto &page = *pool->sparse.get(page_index);
+        page_headers.push_back(
+            {page_index, pool->page_live_counts[page_index]});
+        page_data.insert(page_data.end(), page.begin(), page.end());
+      }
+      record.page_count = static_cast<uint32_t>(page_headers.size());
+      record.page_headers_offset =
+          _write_block(file, page_headers.data(),
+                       page_headers.size() * sizeof(snapshot_page_t));
+      record.page_data_offset = _write_block(
+          file, page_data.data(), page_data.size() * sizeof(uint32_t));
+
+      pools.push_back(record);
+    }
+
+    header.pool_count = static_cast<uint32_t>(pools.size());
+    header.pools_offset = _write_block(file, pools.data(),
+                                       pools.size() * sizeof(snapshot_pool_t));
+    header.strings_offset =
+        _write_block(file, strings.data().data(), strings.data().size());
+    header.strings_size = strings.data().size();
+
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+      return false;
+    stream.write(file.data(), static_cast<std::streamsize>(file.size()));
+    return static_cast<bool>(stream);
+  }
+
+  // loads into a scene without entities. registered types are adopted
+  // block-wise, pools of unknown types are skipped. fails without touching
+  // the scene when the file is missing, truncated, corrupt or from another
+  // version. loaded components are stamped with a tick past both the scene
+  // tick and the saved one, are packed into the groups declared on the scene
+  // and fire on_construct like construct does.
+  bool load(scene_type &scene, const std::filesystem::path &path) const {
+    assert(scene._entities.empty() && "load into an empty scene");
+
+    core::mapped_file_t file;
+    if (!file.open(path) || file.size() < sizeof(snapshot_header_t))
+      return false;
+
+    const std::byte *data = file.data();
+    snapshot_header_t header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != snapshot_magic || header.version != snapshot_version ||
+        header.page_size != page_size)
+      return false;
+
+    // blocks are written aligned, so a misaligned offset is corrupt too
+    auto in_file = [&](uint64_t offset, uint64_t size) {
+      return offset % snapshot_alignment == 0 && offset <= file.size() &&
+             size <= file.size() - offset;
+    };
+
+    if (header.entity_count >= invalid_index ||
+        !in_file(header.entity_ids_offset,
+                 uint64_t(header.entity_count) * sizeof(entity_id_t)) ||
+        !in_file(header.entity_valid_offset, header.entity_count) ||
+        !in_file(header.pools_offset,
+                 uint64_t(header.pool_count) * sizeof(snapshot_pool_t)) ||
+        !in_file(header.strings_offset, header.strings_size))
+      return false;
+
+    const entity_id_t *entity_ids =
+        reinterpret_cast<const entity_id_t *>(data + header.entity_ids_offset);
+    const uint8_t *entity_valid =
+        reinterpret_cast<const uint8_t *>(data + header.entity_valid_offset);
+
+    if (!_valid_entities(header, entity_ids, entity_valid))
+      return false;
+
+    const snapshot_pool_t *pools =
+        reinterpret_cast<const snapshot_pool_t *>(data + header.pools_offset);
+
+    // entry of every pool that gets loaded, validated before the first write
+    std::vector<const entry_t *> loaded(header.pool_count, nullptr);
+    for (uint32_t i = 0; i < header.pool_count; i++) {
+      const snapshot_pool_t &pool = pools[i];
+      uint64_t page_bytes =
+          uint64_t(pool.page_count) * page_size * sizeof(uint32_t);
+      uint64_t records_bytes = uint64_t(pool.count) * pool.record_size;
+      uint64_t entities_bytes = uint64_t(pool.count) * sizeof(entity_id_t);
+      if (!in_file(pool.records_offset, records_bytes) ||
+          !in_file(pool.entities_offset, entities_bytes) ||
+          !in_file(pool.page_headers_offset,
+                   uint64_t(pool.page_count) * sizeof(snapshot_page_t)) ||
+          !in_file(pool.page_data_offset, page_bytes))
+        return false;
+
+      const entry_t *entry = _find(pool.type_hash);
+      if (entry == nullptr || entry->record_size != pool.record_size ||
+          entry->flags != pool.flags)
+        continue;
+
+      for (uint32_t j = 0; j < i; j++)
+        if (loaded[j] == entry)
+          return false;
+
+      if (!_valid_pool(header, pool, data, entity_ids, entity_valid))
+        return false;
+      loaded[i] = entry;
+    }
+
+    scene._entities.resize(header.entity_count);
+    for (uint32_t i = 0; i < header.entity_count; i++)
+      scene._entities[i] = {
+          .id = entity_ids[i], .mask = {}, .is_valid = entity_valid[i] != 0};
+    scene._free_head = header.free_head;
+    scene._alive = header.alive;
+
+    // systems compare against ticks they have already seen, so the loaded
+    // components must look newer than all of them
+    scene._tick = std::max(scene._tick, header.tick);
+    tick_t tick = scene.advance_tick();
+
+    snapshot_string_reader_t strings(
+        reinterpret_cast<const char *>(data + header.strings_offset),
+        header.strings_size);
+
+    for (uint32_t i = 0; i < header.pool_count; i++) {
+      const snapshot_pool_t &record = pools[i];
+      const entry_t *entry = loaded[i];
+      if (entry == nullptr)
+        continue;
+
+      pool_t *pool = scene._try_pool(entry->component_id);
+      assert((pool == nullptr || pool->size() == 0) &&
+             "load into an empty scene");
+
+      entry->load(*entry, scene, data + record.records_offset, record.count,
+                  strings);
+      pool = scene._try_pool(entry->component_id);
+
+      const entity_id_t *ids =
+          reinterpret_cast<const entity_id_t *>(data + record.entities_offset);
+      pool->dense_index_to_entity_id.assign(ids, ids + record.count);
+      pool->added_ticks.assign(record.count, tick);
+      pool->changed_ticks.assign(record.count, tick);
+      pool->last_changed_tick = tick;
+      pool->bump_version();
+
+      const snapshot_page_t *page_headers =
+          reinterpret_cast<const snapshot_page_t *>(data +
+                                                    record.page_headers_offset);
+      const std::byte *page_data = data + record.page_data_offset;
+      for (uint32_t page = 0; page < record.page_count; page++) {
+        uint32_t page_index = page_headers[page].page_index;
+        std::memcpy(pool->sparse.construct(page_index)->data(),
+                    page_data + size_t(page) * page_size * sizeof(uint32_t),
+                    page_size * sizeof(uint32_t));
+
+        if (pool->page_live_counts.size() <= page_index)
+          pool->page_live_counts.resize(page_index + 1, 0);
+        pool->page_live_counts[page_index] = page_headers[page].live_count;
+      }
+
+      for (uint32_t dense_index = 0; dense_index < record.count; dense_index++)
+        scene._entities[entity_index(ids[dense_index])].mask.set(
+            entry->component_id);
+    }
+
+    for (auto &entity : scene._entities)
+      if (entity.is_valid)
+        entity.mask.for_each_set([&](component_id_t component_id) {
+          scene._join_group(entity.id, scene._component_pools[component_id]);
+        });
+
+    for (const entry_t *entry : loaded) {
+      if (entry == nullptr)
+        continue;
+      pool_t *pool = scene._component_pools[entry->component_id];
+      if (pool->on_construct.empty())
+        continue;
+      // a copy, listeners may reorder the pool
+      std::vector<entity_id_t> ids = pool->dense_index_to_entity_id;
+      for (entity_id_t id : ids)
+        pool->on_construct.publish(scene, id);
+    }
+
+    return true;
+  }
+
+private:
+  // live slots hold their own index, dead ones chain into one free list
+  // that ends in invalid_index
+  static bool _valid_entities(const snapshot_header_t &header,
+                              const entity_id_t *entity_ids,
+                              const uint8_t *entity_valid) {
+    uint32_t alive = 0;
+    for (uint32_t i = 0; i < header.entity_count; i++) {
+      if (!entity_valid[i])
+        continue;
+      if (entity_index(entity_ids[i]) != i)
+        return false;
+      ++alive;
+    }
+    if (alive != header.alive)
+      return false;
+
+    uint32_t dead = header.entity_count - alive;
+    uint32_t visited = 0;
+    for (entity_index_t index = header.free_head; index != invalid_index;
+         index = entity_index(entity_ids[index])) {
+      if (index >= header.entity_count || entity_valid[index] ||
+          ++visited > dead)
+        return false;
+    }
+    return visited == dead;
+  }
+
+  // every stored entity is alive and the pages map exactly the stored
+  // entities to their dense index
+  static bool _valid_pool(const snapshot_header_t &header,
+                          const snapshot_pool_t &record, const std::byte *data,
+                          const entity_id_t *entity_ids,
+                          const uint8_t *entity_valid) {
+    const entity_id_t *ids =
+        reinterpret_cast<const entity_id_t *>(data + record.entities_offset);
+    const snapshot_page_t *page_headers =
+        reinterpret_cast<const snapshot_page_t *>(data +
+                                                  record.page_headers_offset);
+    const uint32_t *page_data =
+        reinterpret_cast<const uint32_t *>(data + record.page_data_offset);
+
+    // position of each sparse page in the file
+    std::vector<uint32_t> pages(
+        (uint64_t(header.entity_count) + page_size - 1) / page_size,
+        invalid_index);
+    uint64_t live = 0;
+    for (uint32_t page = 0; page < record.page_count; page++) {
+      uint32_t page_index = page_headers[page].page_index;
+      if (page_index >= pages.size() || pages[page_index] != invalid_index)
+        return false;
+      pages[page_index] = page;
+
+      uint32_t count = 0;
+      for (size_t i = 0; i < page_size; i++) {
+        uint32_t dense_index = page_data[size_t(page) * page_size + i];
+        if (dense_index == invalid_index)
+          continue;
+        if (dense_index >= record.count)
+          return false;
+        ++count;
+      }
+      if (count == 0 || count != page_headers[page].live_count)
+        return false;
+      live += count;
+    }
+    if (live != record.count)
+      return false;
+
+    // with as many entries as entities, each pointing back at its own
+    // entity, there is no room left for stray entries or duplicates
+    for (uint32_t dense_index = 0; dense_index < record.count; dense_index++) {
+      entity_index_t index = entity_index(ids[dense_index]);
+      if (index >= header.entity_count || !entity_valid[index] ||
+          entity_ids[index] != ids[dense_index])
+        return false;
+
+      uint32_t page = pages[index / page_size];
+      if (page == invalid_index ||
+          page_data[size_t(page) * page_size + index % page_size] !=
+              dense_index)
+        return false;
+    }
+    return true;
+  }
+
+  const entry_t *_find(uint64_t type_hash) const {
+    for (const entry_t &entry : _entries)
+      if (entry.type_hash == type_hash)
+        return &entry;
+    return nullptr;
+  }
+
+  // appends an aligned block and returns its offset
+  static uint64_t _write_block(std::string &file, const void *data,
+                               size_t size) {
+    size_t offset = (file.size() + snapshot_alignment - 1) &
+                    ~(snapshot_alignment - 1);
+    file.resize(offset + size, '\0');
+    if (size > 0)
+      std::memcpy(file.data() + offset, data, size);
+    return offset;
+  }
+
+  template <typename T>
+  static component_pool_t<T, page_size> *_typed(pool_t *pool) {
+    return static_cast<component_pool_t<T, page_size> *>(pool);
+  }
+
+  template <typename T>
+  static void _save_trivial(const entry_t &, pool_t *pool, std::string &records,
+                            snapshot_string_writer_t &) {
+    auto *typed = _typed<T>(pool);
+    records.assign(reinterpret_cast<const char *>(typed->dense.data()),
+                   typed->dense.size() * sizeof(T));
+  }
+
+  template <typename T>
+  static void _load_trivial(const entry_t &, scene_type &scene,
+                            const std::byte *records, uint32_t count,
+                            const snapshot_string_reader_t &) {
+    auto *pool = scene.template _assure_pool<T>();
+    pool->reserve(count);
+    pool->dense.append_n(reinterpret_cast<const T *>(records), count);
+    pool->dense_appended();
+  }
+
+  template <typename T, typename record_t>
+  static void _save_records(const entry_t &entry, pool_t *pool,
+                            std::string &records,
+                            snapshot_string_writer_t &strings) {
+    auto to_record =
+        reinterpret_cast<record_t (*)(const T &, snapshot_string_writer_t &)>(
+            entry.to_record);
+    auto *typed = _typed<T>(pool);
+
+    records.resize(size_t(typed->dense.size()) * sizeof(record_t));
+    for (uint32_t i = 0; i < typed->dense.size(); i++) {
+      record_t record = to_record(typed->dense[i], strings);
+      std::memcpy(records.data() + size_t(i) * sizeof(record_t), &record,
+                  sizeof(record_t));
+    }
+  }
+
+  template <typename T, typename record_t>
+  static void _load_records(const entry_t &entry, scene_type &scene,
+                            const std::byte *records, uint32_t count,
+                            const snapshot_string_reader_t &strings) {
+    auto from_record = reinterpret_cast<T (*)(
+        const record_t &, const snapshot_string_reader_t &)>(entry.from_record);
+    auto *pool = scene.template _assure_pool<T>();
+    pool->reserve(count);
+    pool->dense.append_n(count, [&](uint32_t i) {
+      record_t record;
+      std::memcpy(&record, records + size_t(i) * sizeof(record_t),
+                  sizeof(record_t));
+      return from_record(record, strings);
+    });
+    pool->dense_appended();
+  }
+
+  std::vector<entry_t> _entries;
+};
+
+} // namespace ecs
+#endif
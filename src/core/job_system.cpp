@@ -0,0 +1,168 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+
+namespace core
+{
+    // pool and queue owned by the current thread, workers of another pool count as outsiders
+    static thread_local const job_system_t* currentSystem = nullptr;
+    static thread_local uint32_t currentQueue = 0;
+
+    uint32_t job_system_t::defaultThreadCount()
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+
+    uint32_t job_system_t::threadIndex() const
+    {
+        return currentSystem == this ? currentQueue : 0;
+    }
+
+    job_system_t::job_system_t(uint32_t threadCount)
+    {
+        _queues.reserve(threadCount + 1);
+        for (uint32_t i = 0; i < threadCount + 1; ++i)
+            _queues.push_back(std::make_unique<task_queue_t>());
+
+        _threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; ++i)
+            _threads.emplace_back(&job_system_t::workerLoop, this, i + 1);
+    }
+
+    job_system_t::~job_system_t()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+
+        for (auto& thread : _threads)
+            thread.join();
+    }
+
+    void job_system_t::parallelFor(uint32_t count, uint32_t grainSize, const range_fn& fn)
+    {
+        if (count == 0)
+            return;
+
+        grainSize = std::max(grainSize, 1u);
+        const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+        if (chunkCount == 1 || _threads.empty())
+        {
+            for (uint32_t begin = 0; begin < count; begin += grainSize)
+                fn(begin, std::min(begin + grainSize, count));
+            return;
+        }
+
+        const uint32_t localQueue = threadIndex();
+
+        std::atomic<uint32_t> remaining{chunkCount};
+        _pending.fetch_add(chunkCount);
+
+        // round-robin the chunks so every worker starts with local work
+        for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            task_t task{};
+            task.fn = &fn;
+            task.begin = chunk * grainSize;
+            task.end = std::min(task.begin + grainSize, count);
+            task.remaining = &remaining;
+
+            task_queue_t& queue = *_queues[(localQueue + chunk) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(task);
+        }
+
+        {
+            // pairs with the predicate check in workerLoop so no wakeup is lost
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+        }
+        _wake.notify_all();
+
+        while (remaining.load(std::memory_order_acquire) > 0)
+        {
+            task_t task;
+            if (findTask(localQueue, task))
+                runTask(task);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void job_system_t::workerLoop(uint32_t queueIndex)
+    {
+        currentSystem = this;
+        currentQueue = queueIndex;
+
+        while (true)
+        {
+            task_t task;
+            if (findTask(queueIndex, task))
+            {
+                runTask(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _wake.wait(lock, [this]() { return _stop || _pending.load() > 0; });
+
+            if (_stop)
+                return;
+        }
+    }
+
+    bool job_system_t::popTask(uint32_t queueIndex, task_t& task)
+    {
+        task_queue_t& queue = *_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+            return false;
+
+        // owner works LIFO to stay on warm data
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool job_system_t::stealTask(uint32_t thiefIndex, task_t& task)
+    {
+        const uint32_t queueCount = static_cast<uint32_t>(_queues.size());
+
+        for (uint32_t offset = 1; offset < queueCount; ++offset)
+        {
+            task_queue_t& queue = *_queues[(thiefIndex + offset) % queueCount];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (queue.tasks.empty())
+                continue;
+
+            // thieves take the oldest task from the other end
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return true;
+        }
+
+        return false;
+    }
+
+    bool job_system_t::findTask(uint32_t queueIndex, task_t& task)
+    {
+        if (popTask(queueIndex, task) || stealTask(queueIndex, task))
+        {
+            _pending.fetch_sub(1);
+            return true;
+        }
+
+        return false;
+    }
+
+    void job_system_t::runTask(task_t& task)
+    {
+        (*task.fn)(task.begin, task.end);
+        task.remaining->fetch_sub(1, std::memory_order_release);
+    }
+} // namespace core
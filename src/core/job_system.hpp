@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+    // work-stealing thread pool shared by the whole engine.
+    // parallelFor splits [0, count) into fixed chunks of grainSize elements, so chunk
+    // boundaries only depend on count and grainSize, never on thread timing.
+    class job_system_t
+    {
+    public:
+        using range_fn = std::function<void(uint32_t begin, uint32_t end)>;
+
+        static job_system_t& getInstance() {
+            static job_system_t instance;
+            return instance;
+        }
+
+        explicit job_system_t(uint32_t threadCount = defaultThreadCount());
+        ~job_system_t();
+
+        job_system_t(const job_system_t&) = delete;
+        job_system_t& operator=(const job_system_t&) = delete;
+
+        // blocks until every chunk ran, the calling thread helps while it waits so
+        // nested calls from inside a job are fine
+        void parallelFor(uint32_t count, uint32_t grainSize, const range_fn& fn);
+
+        uint32_t workerCount() const { return static_cast<uint32_t>(_threads.size()); }
+
+        // 0 for threads outside the pool, i + 1 for worker i. sized for per-thread scratch
+        // data, threadIndex() < threadCount() always holds
+        uint32_t threadIndex() const;
+        uint32_t threadCount() const { return static_cast<uint32_t>(_queues.size()); }
+
+        static uint32_t defaultThreadCount();
+    private:
+        struct task_t
+        {
+            const range_fn* fn = nullptr;
+            uint32_t begin = 0;
+            uint32_t end = 0;
+            std::atomic<uint32_t>* remaining = nullptr;
+        };
+
+        struct task_queue_t
+        {
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+        };
+
+        void workerLoop(uint32_t queueIndex);
+
+        bool popTask(uint32_t queueIndex, task_t& task);
+        bool stealTask(uint32_t thiefIndex, task_t& task);
+        bool findTask(uint32_t queueIndex, task_t& task);
+        void runTask(task_t& task);
+
+        // queue 0 is fed by threads outside the pool, queue i + 1 belongs to worker i
+        std::vector<std::unique_ptr<task_queue_t>> _queues;
+        std::vector<std::thread> _threads;
+
+        std::mutex _sleepMutex;
+        std::condition_variable _wake;
+        std::atomic<uint32_t> _pending{0};
+        bool _stop = false;
+    };
+} // namespace core
@@ -0,0 +1,109 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace core
+{
+    mapped_file_t::~mapped_file_t()
+    {
+        close();
+    }
+
+#ifdef _WIN32
+    bool mapped_file_t::open(const std::filesystem::path& path)
+    {
+        close();
+
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        _file = file;
+        _mapping = mapping;
+        _data = static_cast<const std::byte*>(view);
+        _size = static_cast<size_t>(fileSize.QuadPart);
+        return true;
+    }
+
+    void mapped_file_t::close()
+    {
+        if (_data)
+            UnmapViewOfFile(_data);
+        if (_mapping)
+            CloseHandle(_mapping);
+        if (_file)
+            CloseHandle(_file);
+
+        _data = nullptr;
+        _mapping = nullptr;
+        _file = nullptr;
+        _size = 0;
+    }
+#else
+    bool mapped_file_t::open(const std::filesystem::path& path)
+    {
+        close();
+
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat info{};
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            ::close(file);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        // the mapping keeps its own reference to the file
+        ::close(file);
+
+        if (view == MAP_FAILED)
+            return false;
+
+        _data = static_cast<const std::byte*>(view);
+        _size = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    void mapped_file_t::close()
+    {
+        if (_data)
+            munmap(const_cast<std::byte*>(_data), _size);
+
+        _data = nullptr;
+        _size = 0;
+    }
+#endif
+} // namespace core
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace core
+{
+    // read-only memory mapping of a whole file, the view stays valid until the object dies
+    class mapped_file_t
+    {
+    public:
+        mapped_file_t() = default;
+        ~mapped_file_t();
+
+        mapped_file_t(const mapped_file_t&) = delete;
+        mapped_file_t& operator=(const mapped_file_t&) = delete;
+
+        bool open(const std::filesystem::path& path);
+        void close();
+
+        const std::byte* data() const { return _data; }
+        size_t size() const { return _size; }
+        bool isOpen() const { return _data != nullptr; }
+    private:
+        const std::byte* _data = nullptr;
+        size_t _size = 0;
+
+#ifdef _WIN32
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#endif
+    };
+} // namespace core
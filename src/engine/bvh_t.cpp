@@ -0,0 +1,529 @@
+#include "bvh_t.hpp"
+
+#include <cassert>
+
+namespace eng
+{
+    aabb_t aabb_t::transform(const aabb_t& local, const glm::mat4& world)
+    {
+        // every world axis is the translation plus the extreme contribution of each local axis
+        aabb_t result;
+        result.min = result.max = glm::vec3(world[3]);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                const float a = world[i][j] * local.min[i];
+                const float b = world[i][j] * local.max[i];
+                result.min[j] += glm::min(a, b);
+                result.max[j] += glm::max(a, b);
+            }
+        }
+
+        return result;
+    }
+
+    bvh_t::proxy_t bvh_t::insert(const aabb_t& bounds, uint64_t user)
+    {
+        const int32_t leaf = allocate();
+        _nodes[leaf].bounds = bounds;
+        _nodes[leaf].user = user;
+
+        insertLeaf(leaf);
+        ++_leafCount;
+
+        return leaf;
+    }
+
+    void bvh_t::remove(proxy_t proxy)
+    {
+        assert(proxy >= 0 && _nodes[proxy].leaf());
+
+        removeLeaf(proxy);
+        release(proxy);
+        --_leafCount;
+    }
+
+    void bvh_t::update(proxy_t proxy, const aabb_t& bounds)
+    {
+        node_t& node = _nodes[proxy];
+        node.bounds = bounds;
+
+        if (!node.updated)
+        {
+            node.updated = true;
+            _updated.push_back(proxy);
+        }
+    }
+
+    void bvh_t::refit()
+    {
+        // bounds first, every ancestor of a moved leaf is exact before anything is rotated
+        for (int32_t leaf : _updated)
+        {
+            // removed since, or already walked
+            if (!_nodes[leaf].updated)
+                continue;
+
+            _nodes[leaf].updated = false;
+            refitUpwards(_nodes[leaf].parent);
+        }
+        _updated.clear();
+
+        // rotating keeps a node's bounds and recomputes the child it changes, so with exact
+        // bounds everywhere the order does not matter
+        for (int32_t node : _rotations)
+        {
+            // released since, reused as a leaf or already rotated
+            if (!_nodes[node].updated || _nodes[node].leaf())
+                continue;
+
+            _nodes[node].updated = false;
+            rotate(node);
+        }
+        _rotations.clear();
+    }
+
+    void bvh_t::build()
+    {
+        if (_root != -1)
+            rebuildSubtree(_root);
+    }
+
+    void bvh_t::rebuildPartial()
+    {
+        if (_root == -1)
+            return;
+
+        refit();
+
+        // small trees have no subtrees worth rotating through
+        if (_leafCount <= (1u << partialDepth))
+        {
+            build();
+            return;
+        }
+
+        std::vector<int32_t> level{_root};
+        std::vector<int32_t> next;
+        for (uint32_t depth = 0; depth < partialDepth; ++depth)
+        {
+            next.clear();
+            for (int32_t node : level)
+            {
+                if (!_nodes[node].leaf())
+                {
+                    next.push_back(_nodes[node].left);
+                    next.push_back(_nodes[node].right);
+                }
+            }
+
+            if (next.empty())
+                break;
+            level.swap(next);
+        }
+
+        rebuildSubtree(level[_nextPartial++ % level.size()]);
+    }
+
+    float bvh_t::cost() const
+    {
+        if (_root == -1)
+            return 0.0f;
+
+        float area = 0.0f;
+        std::vector<int32_t> stack{_root};
+        while (!stack.empty())
+        {
+            const node_t& node = _nodes[stack.back()];
+            stack.pop_back();
+
+            area += node.bounds.surfaceArea();
+            if (!node.leaf())
+            {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+
+        const float rootArea = _nodes[_root].bounds.surfaceArea();
+        return rootArea > 0.0f ? area / rootArea : 0.0f;
+    }
+
+    bool bvh_t::validate() const
+    {
+        if (_root == -1)
+            return _leafCount == 0;
+        if (_nodes[_root].parent != -1)
+            return false;
+
+        uint32_t leaves = 0;
+        std::vector<int32_t> stack{_root};
+        while (!stack.empty())
+        {
+            const int32_t index = stack.back();
+            const node_t& node = _nodes[index];
+            stack.pop_back();
+
+            if (node.leaf())
+            {
+                ++leaves;
+                continue;
+            }
+
+            for (int32_t child : {node.left, node.right})
+            {
+                const aabb_t& bounds = _nodes[child].bounds;
+                if (_nodes[child].parent != index || !(aabb_t::merge(node.bounds, bounds) == node.bounds))
+                    return false;
+                stack.push_back(child);
+            }
+        }
+
+        return leaves == _leafCount;
+    }
+
+    bvh_t::ray_hit_t bvh_t::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+    {
+        return raycast(origin, direction, maxDistance, [](uint64_t, float boxDistance) { return boxDistance; });
+    }
+
+    int32_t bvh_t::allocate()
+    {
+        if (_free != -1)
+        {
+            const int32_t node = _free;
+            _free = _nodes[node].parent;
+            _nodes[node] = node_t{};
+            return node;
+        }
+
+        _nodes.emplace_back();
+        return static_cast<int32_t>(_nodes.size() - 1);
+    }
+
+    void bvh_t::release(int32_t node)
+    {
+        _nodes[node] = node_t{};
+        _nodes[node].parent = _free;
+        _free = node;
+    }
+
+    void bvh_t::insertLeaf(int32_t leaf)
+    {
+        if (_root == -1)
+        {
+            _root = leaf;
+            _nodes[leaf].parent = -1;
+            return;
+        }
+
+        // descend towards the sibling that adds the least surface area, stopping once pairing
+        // with the current node is cheaper than going further down
+        const aabb_t leafBounds = _nodes[leaf].bounds;
+        int32_t index = _root;
+
+        while (!_nodes[index].leaf())
+        {
+            const node_t& node = _nodes[index];
+
+            const float area = node.bounds.surfaceArea();
+            const float combinedArea = aabb_t::merge(node.bounds, leafBounds).surfaceArea();
+
+            const float cost = 2.0f * combinedArea;
+            // every node on the way down grows by this much
+            const float inheritance = 2.0f * (combinedArea - area);
+
+            auto descendCost = [&](int32_t child) {
+                const node_t& childNode = _nodes[child];
+                float childCost = aabb_t::merge(leafBounds, childNode.bounds).surfaceArea();
+                if (!childNode.leaf())
+                    childCost -= childNode.bounds.surfaceArea();
+                return childCost + inheritance;
+            };
+
+            const float leftCost = descendCost(node.left);
+            const float rightCost = descendCost(node.right);
+
+            if (cost < leftCost && cost < rightCost)
+                break;
+
+            index = leftCost < rightCost ? node.left : node.right;
+        }
+
+        const int32_t sibling = index;
+        const int32_t oldParent = _nodes[sibling].parent;
+
+        // allocating may move the nodes, no references across it
+        const int32_t newParent = allocate();
+        _nodes[newParent].parent = oldParent;
+        _nodes[newParent].left = sibling;
+        _nodes[newParent].right = leaf;
+        _nodes[newParent].bounds = aabb_t::merge(_nodes[sibling].bounds, leafBounds);
+        _nodes[sibling].parent = newParent;
+        _nodes[leaf].parent = newParent;
+
+        if (oldParent == -1)
+            _root = newParent;
+        else
+            replaceChild(oldParent, sibling, newParent);
+
+        refitUpwards(oldParent);
+    }
+
+    void bvh_t::removeLeaf(int32_t leaf)
+    {
+        if (leaf == _root)
+        {
+            _root = -1;
+            return;
+        }
+
+        const int32_t parent = _nodes[leaf].parent;
+        const int32_t grandParent = _nodes[parent].parent;
+        const int32_t sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+
+        _nodes[sibling].parent = grandParent;
+        if (grandParent == -1)
+            _root = sibling;
+        else
+            replaceChild(grandParent, parent, sibling);
+
+        release(parent);
+        refitUpwards(grandParent);
+    }
+
+    void bvh_t::refitUpwards(int32_t index)
+    {
+        while (index != -1)
+        {
+            node_t& node = _nodes[index];
+            const aabb_t bounds = aabb_t::merge(_nodes[node.left].bounds, _nodes[node.right].bounds);
+            const bool changed = !(bounds == node.bounds);
+            node.bounds = bounds;
+
+            // rotated by the next refit, once no ancestor of another moved leaf is stale
+            if (!node.updated)
+            {
+                node.updated = true;
+                _rotations.push_back(index);
+            }
+
+            // nothing above can change either
+            if (!changed)
+                break;
+
+            index = node.parent;
+        }
+    }
+
+    void bvh_t::rotate(int32_t index)
+    {
+        const int32_t left = _nodes[index].left;
+        const int32_t right = _nodes[index].right;
+
+        // swapping a child with a grandchild on the other side, the one that shrinks the other
+        // side's bounds the most wins
+        float bestGain = 0.0f;
+        int32_t child = -1;
+        int32_t grandChild = -1;
+
+        auto consider = [&](int32_t candidate, int32_t other, int32_t swapped, int32_t kept) {
+            const float gain = _nodes[other].bounds.surfaceArea()
+                - aabb_t::merge(_nodes[candidate].bounds, _nodes[kept].bounds).surfaceArea();
+            if (gain > bestGain)
+            {
+                bestGain = gain;
+                child = candidate;
+                grandChild = swapped;
+            }
+        };
+
+        if (!_nodes[right].leaf())
+        {
+            consider(left, right, _nodes[right].left, _nodes[right].right);
+            consider(left, right, _nodes[right].right, _nodes[right].left);
+        }
+        if (!_nodes[left].leaf())
+        {
+            consider(right, left, _nodes[left].left, _nodes[left].right);
+            consider(right, left, _nodes[left].right, _nodes[left].left);
+        }
+
+        if (child == -1)
+            return;
+
+        const int32_t other = _nodes[grandChild].parent;
+
+        replaceChild(index, child, grandChild);
+        _nodes[grandChild].parent = index;
+
+        replaceChild(other, grandChild, child);
+        _nodes[child].parent = other;
+
+        _nodes[other].bounds = aabb_t::merge(_nodes[_nodes[other].left].bounds, _nodes[_nodes[other].right].bounds);
+    }
+
+    void bvh_t::replaceChild(int32_t parent, int32_t oldChild, int32_t newChild)
+    {
+        node_t& node = _nodes[parent];
+        if (node.left == oldChild)
+            node.left = newChild;
+        else
+        {
+            assert(node.right == oldChild);
+            node.right = newChild;
+        }
+    }
+
+    void bvh_t::rebuildSubtree(int32_t index)
+    {
+        if (_nodes[index].leaf())
+            return;
+
+        const int32_t parent = _nodes[index].parent;
+
+        // the leaves are kept, the inner nodes are released and rebuilt
+        _leaves.clear();
+        std::vector<int32_t> stack{index};
+        while (!stack.empty())
+        {
+            const int32_t node = stack.back();
+            stack.pop_back();
+
+            if (_nodes[node].leaf())
+            {
+                _leaves.push_back(node);
+                continue;
+            }
+
+            stack.push_back(_nodes[node].left);
+            stack.push_back(_nodes[node].right);
+            if (node != index)
+                release(node);
+        }
+
+        // released last, so the rebuilt root takes its slot again
+        release(index);
+        const int32_t subtree = buildRange(_leaves.data(), static_cast<uint32_t>(_leaves.size()), parent);
+
+        if (parent == -1)
+            _root = subtree;
+        else
+            replaceChild(parent, index, subtree);
+    }
+
+    int32_t bvh_t::buildRange(int32_t* leaves, uint32_t count, int32_t parent)
+    {
+        if (count == 1)
+        {
+            _nodes[leaves[0]].parent = parent;
+            return leaves[0];
+        }
+
+        aabb_t centroids;
+        for (uint32_t i = 0; i < count; ++i)
+            centroids.expand(_nodes[leaves[i]].bounds.center());
+
+        const glm::vec3 extent = centroids.max - centroids.min;
+        int axis = 0;
+        if (extent.y > extent[axis])
+            axis = 1;
+        if (extent.z > extent[axis])
+            axis = 2;
+
+        uint32_t middle = 0;
+
+        if (extent[axis] > 0.0f)
+        {
+            // bin the centroids along the widest axis and split at the plane of lowest SAH cost
+            struct bin_t
+            {
+                aabb_t bounds;
+                uint32_t count = 0;
+            };
+            std::array<bin_t, binCount> bins{};
+
+            const float scale = binCount / extent[axis];
+            auto binOf = [&](int32_t leaf) {
+                const float offset = _nodes[leaf].bounds.center()[axis] - centroids.min[axis];
+                return std::min(binCount - 1, static_cast<uint32_t>(offset * scale));
+            };
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                bin_t& bin = bins[binOf(leaves[i])];
+                bin.bounds.expand(_nodes[leaves[i]].bounds);
+                ++bin.count;
+            }
+
+            // cost of the left side for every plane, plane i splits after bin i
+            std::array<float, binCount - 1> leftCost{};
+            aabb_t leftBounds;
+            uint32_t leftCount = 0;
+            for (uint32_t i = 0; i < binCount - 1; ++i)
+            {
+                leftBounds.expand(bins[i].bounds);
+                leftCount += bins[i].count;
+                leftCost[i] = leftCount == 0 ? 0.0f : leftBounds.surfaceArea() * leftCount;
+            }
+
+            float bestCost = std::numeric_limits<float>::max();
+            uint32_t bestPlane = 0;
+            aabb_t rightBounds;
+            uint32_t rightCount = 0;
+            for (uint32_t i = binCount - 1; i > 0; --i)
+            {
+                rightBounds.expand(bins[i].bounds);
+                rightCount += bins[i].count;
+
+                const float cost = leftCost[i - 1] + (rightCount == 0 ? 0.0f : rightBounds.surfaceArea() * rightCount);
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestPlane = i - 1;
+                }
+            }
+
+            int32_t* split = std::partition(leaves, leaves + count,
+                [&](int32_t leaf) { return binOf(leaf) <= bestPlane; });
+            middle = static_cast<uint32_t>(split - leaves);
+        }
+
+        // coincident centroids, or every leaf in one bin: split in the middle instead
+        if (middle == 0 || middle == count)
+        {
+            middle = count / 2;
+            std::nth_element(leaves, leaves + middle, leaves + count, [&](int32_t a, int32_t b) {
+                return _nodes[a].bounds.center()[axis] < _nodes[b].bounds.center()[axis];
+            });
+        }
+
+        const int32_t node = allocate();
+        _nodes[node].parent = parent;
+
+        const int32_t left = buildRange(leaves, middle, node);
+        const int32_t right = buildRange(leaves + middle, count - middle, node);
+
+        _nodes[node].left = left;
+        _nodes[node].right = right;
+        _nodes[node].bounds = aabb_t::merge(_nodes[left].bounds, _nodes[right].bounds);
+
+        return node;
+    }
+
+    float bvh_t::intersect(const aabb_t& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+    {
+        const glm::vec3 t0 = (bounds.min - origin) * inverseDirection;
+        const glm::vec3 t1 = (bounds.max - origin) * inverseDirection;
+
+        const glm::vec3 near = glm::min(t0, t1);
+        const glm::vec3 far = glm::max(t0, t1);
+
+        const float enter = glm::max(glm::max(near.x, near.y), glm::max(near.z, 0.0f));
+        const float exit = glm::min(glm::min(far.x, far.y), glm::min(far.z, maxDistance));
+
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+} // namespace eng
@@ -0,0 +1,300 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace eng
+{
+    struct aabb_t
+    {
+        glm::vec3 min{std::numeric_limits<float>::max()};
+        glm::vec3 max{-std::numeric_limits<float>::max()};
+
+        void expand(const glm::vec3& point)
+        {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        void expand(const aabb_t& other)
+        {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+
+        float surfaceArea() const
+        {
+            const glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        bool overlaps(const aabb_t& other) const
+        {
+            return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+        }
+
+        bool operator==(const aabb_t& other) const { return min == other.min && max == other.max; }
+
+        static aabb_t merge(const aabb_t& a, const aabb_t& b)
+        {
+            aabb_t result = a;
+            result.expand(b);
+            return result;
+        }
+
+        // the box around local moved by world, without transforming all eight corners
+        static aabb_t transform(const aabb_t& local, const glm::mat4& world);
+    };
+
+    // dynamic bounding volume hierarchy over user handles (entity ids). leaves move with update and
+    // refit, which fixes up their ancestors and rotates nodes on the way to keep the surface area
+    // low. refitting alone lets the tree degrade as things move, so rebuildPartial rebuilds one top
+    // level subtree at a time with binned SAH, and build rebuilds everything
+    class bvh_t
+    {
+    public:
+        using proxy_t = int32_t;
+        static constexpr proxy_t null_proxy = -1;
+
+        struct ray_hit_t
+        {
+            uint64_t user = 0;
+            float distance = std::numeric_limits<float>::infinity();
+
+            bool hit() const { return distance != std::numeric_limits<float>::infinity(); }
+        };
+
+        proxy_t insert(const aabb_t& bounds, uint64_t user);
+        void remove(proxy_t proxy);
+
+        // moves a leaf, its ancestors are fixed up by the next refit
+        void update(proxy_t proxy, const aabb_t& bounds);
+        void refit();
+
+        void build();
+        void rebuildPartial();
+
+        uint64_t user(proxy_t proxy) const { return _nodes[proxy].user; }
+        const aabb_t& bounds(proxy_t proxy) const { return _nodes[proxy].bounds; }
+        uint32_t size() const { return _leafCount; }
+
+        // surface area heuristic cost relative to the root, lower is better
+        float cost() const;
+
+        // every inner node's bounds contain its children and the parent links agree, for tests and
+        // debug checks
+        bool validate() const;
+
+        // planes are (normal, distance) with normals pointing inside, like frustum_culler_t::planes.
+        // subtrees fully inside are reported without testing their nodes
+        template <typename F>
+        void queryFrustum(const std::array<glm::vec4, 6>& planes, F&& visit) const;
+
+        template <typename F>
+        void queryAabb(const aabb_t& bounds, F&& visit) const;
+
+        // closest leaf box the ray enters within maxDistance. test(user, boxDistance) may refine the
+        // hit against the real shape and returns its distance, or infinity for a miss
+        ray_hit_t raycast(const glm::vec3& origin, const glm::vec3& direction,
+                          float maxDistance = std::numeric_limits<float>::infinity()) const;
+        template <typename F>
+        ray_hit_t raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, F&& test) const;
+    private:
+        struct node_t
+        {
+            aabb_t bounds;
+            int32_t parent = -1;
+            // both -1 for leaves
+            int32_t left = -1;
+            int32_t right = -1;
+            uint64_t user = 0;
+            // leaves waiting for refit, so a leaf updated twice is only walked once, and inner
+            // nodes waiting to be rotated by it
+            bool updated = false;
+
+            bool leaf() const { return left == -1; }
+        };
+
+        // subtrees rooted this deep are rebuilt in turn by rebuildPartial
+        static constexpr uint32_t partialDepth = 3;
+        static constexpr uint32_t binCount = 16;
+
+        int32_t allocate();
+        void release(int32_t node);
+
+        void insertLeaf(int32_t leaf);
+        void removeLeaf(int32_t leaf);
+        // recomputes bounds from node up to the root, queueing every node passed for rotation
+        void refitUpwards(int32_t node);
+        void rotate(int32_t node);
+        void replaceChild(int32_t parent, int32_t oldChild, int32_t newChild);
+
+        void rebuildSubtree(int32_t node);
+        int32_t buildRange(int32_t* leaves, uint32_t count, int32_t parent);
+
+        // distance along the ray to the box, infinity when it misses or starts past maxDistance
+        static float intersect(const aabb_t& bounds, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance);
+
+        std::vector<node_t> _nodes;
+        int32_t _root = -1;
+        // released nodes chained through their parent index
+        int32_t _free = -1;
+        uint32_t _leafCount = 0;
+
+        std::vector<int32_t> _updated;
+        std::vector<int32_t> _rotations;
+        uint32_t _nextPartial = 0;
+
+        // scratch kept between rebuilds
+        std::vector<int32_t> _leaves;
+    };
+
+    template <typename F>
+    void bvh_t::queryFrustum(const std::array<glm::vec4, 6>& planes, F&& visit) const
+    {
+        if (_root == -1)
+            return;
+
+        // the second element tells whether the node is known to be fully inside
+        std::vector<std::pair<int32_t, bool>> stack;
+        stack.reserve(64);
+        stack.push_back({_root, false});
+
+        while (!stack.empty())
+        {
+            auto [index, inside] = stack.back();
+            stack.pop_back();
+            const node_t& node = _nodes[index];
+
+            if (!inside)
+            {
+                bool outside = false;
+                inside = true;
+
+                for (const glm::vec4& plane : planes)
+                {
+                    const glm::vec3 normal(plane);
+                    // the corners furthest along and against the normal
+                    const glm::vec3 positive = glm::mix(node.bounds.min, node.bounds.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+                    const glm::vec3 negative = glm::mix(node.bounds.max, node.bounds.min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+                    if (glm::dot(normal, positive) + plane.w < 0.0f)
+                    {
+                        outside = true;
+                        break;
+                    }
+                    if (glm::dot(normal, negative) + plane.w < 0.0f)
+                        inside = false;
+                }
+
+                if (outside)
+                    continue;
+            }
+
+            if (node.leaf())
+            {
+                visit(node.user);
+                continue;
+            }
+
+            stack.push_back({node.left, inside});
+            stack.push_back({node.right, inside});
+        }
+    }
+
+    template <typename F>
+    void bvh_t::queryAabb(const aabb_t& bounds, F&& visit) const
+    {
+        if (_root == -1)
+            return;
+
+        std::vector<int32_t> stack;
+        stack.reserve(64);
+        stack.push_back(_root);
+
+        while (!stack.empty())
+        {
+            const node_t& node = _nodes[stack.back()];
+            stack.pop_back();
+
+            if (!node.bounds.overlaps(bounds))
+                continue;
+
+            if (node.leaf())
+            {
+                visit(node.user);
+                continue;
+            }
+
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    template <typename F>
+    bvh_t::ray_hit_t bvh_t::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, F&& test) const
+    {
+        ray_hit_t closest;
+        if (_root == -1)
+            return closest;
+
+        // zero components become infinities, which the slab test handles
+        const glm::vec3 inverseDirection = 1.0f / direction;
+
+        std::vector<std::pair<int32_t, float>> stack;
+        stack.reserve(64);
+
+        float rootDistance = intersect(_nodes[_root].bounds, origin, inverseDirection, maxDistance);
+        if (rootDistance != std::numeric_limits<float>::infinity())
+            stack.push_back({_root, rootDistance});
+
+        while (!stack.empty())
+        {
+            auto [index, distance] = stack.back();
+            stack.pop_back();
+
+            // a closer hit was found since this node was pushed
+            if (distance >= closest.distance)
+                continue;
+
+            const node_t& node = _nodes[index];
+            if (node.leaf())
+            {
+                float hitDistance = test(node.user, distance);
+                if (hitDistance < closest.distance && hitDistance <= maxDistance)
+                    closest = {node.user, hitDistance};
+                continue;
+            }
+
+            const float limit = std::min(maxDistance, closest.distance);
+            float leftDistance = intersect(_nodes[node.left].bounds, origin, inverseDirection, limit);
+            float rightDistance = intersect(_nodes[node.right].bounds, origin, inverseDirection, limit);
+
+            // nearer child last, so it is popped first and can prune the other
+            int32_t nearChild = node.left;
+            int32_t farChild = node.right;
+            if (rightDistance < leftDistance)
+            {
+                std::swap(nearChild, farChild);
+                std::swap(leftDistance, rightDistance);
+            }
+
+            if (rightDistance != std::numeric_limits<float>::infinity())
+                stack.push_back({farChild, rightDistance});
+            if (leftDistance != std::numeric_limits<float>::infinity())
+                stack.push_back({nearChild, leftDistance});
+        }
+
+        return closest;
+    }
+} // namespace eng
@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "core/ecs.hpp"
+#include "engine/components.hpp"
 #include "engine/transform_t.hpp"
 
 namespace eng
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core/ecs.hpp"
+
+namespace core
+{
+    struct name_t;
+    struct path_t;
+} // namespace core
+
+namespace eng
+{
+    struct transform_t;
+    struct hierarchy_t;
+    struct world_transform_t;
+    struct texture_t;
+    class model_t;
+} // namespace eng
+
+// ids of every component type the engine stores in scenes, give new types the next free id
+ECS_COMPONENT(core::name_t, 0)
+ECS_COMPONENT(core::path_t, 1)
+ECS_COMPONENT(eng::transform_t, 2)
+ECS_COMPONENT(eng::hierarchy_t, 3)
+ECS_COMPONENT(eng::world_transform_t, 4)
+ECS_COMPONENT(eng::model_t, 5)
+ECS_COMPONENT(eng::texture_t, 6)
@@ -0,0 +1,165 @@
+#include "frustum_culler_t.hpp"
+#include "model_t.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+// the widest path the build targets is used, see ENGINE_SIMD in CMakeLists.txt. msvc never
+// defines __SSE2__, it is always there on x64 and with /arch:SSE2 on x86
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2
+#endif
+
+#if defined(__AVX2__) || defined(FRUSTUM_CULLER_SSE2)
+#include <immintrin.h>
+#endif
+
+namespace eng
+{
+    static glm::vec4 row(const glm::mat4& m, int i)
+    {
+        return { m[0][i], m[1][i], m[2][i], m[3][i] };
+    }
+
+    void frustum_culler_t::setCamera(const glm::mat4& projection, const glm::mat4& view, float viewportHeight)
+    {
+        const glm::mat4 viewProjection = projection * view;
+        const glm::vec4 x = row(viewProjection, 0);
+        const glm::vec4 y = row(viewProjection, 1);
+        const glm::vec4 z = row(viewProjection, 2);
+        const glm::vec4 w = row(viewProjection, 3);
+
+        // depth is zero to one, so the near plane is z >= 0 rather than z >= -w
+        _planes = { w + x, w - x, w + y, w - y, z, w - z };
+        for (glm::vec4& plane : _planes)
+            plane /= glm::length(glm::vec3(plane));
+
+        _depth = w;
+        // the vertical scale is negative when the projection flips y
+        _pixelScale = glm::abs(projection[1][1]) * viewportHeight;
+    }
+
+    void frustum_culler_t::clear()
+    {
+        _x.clear();
+        _y.clear();
+        _z.clear();
+        _radius.clear();
+        _count = 0;
+    }
+
+    void frustum_culler_t::add(const glm::mat4& world, const bounds_t& bounds)
+    {
+        const glm::vec3 center = glm::vec3(world * glm::vec4(bounds.center, 1.0f));
+        // non uniform scale stretches the sphere by its largest axis
+        const float scale = glm::sqrt(glm::max(glm::max(
+            glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+            glm::dot(glm::vec3(world[1]), glm::vec3(world[1]))),
+            glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))));
+
+        _x.push_back(center.x);
+        _y.push_back(center.y);
+        _z.push_back(center.z);
+        _radius.push_back(bounds.radius * scale);
+        ++_count;
+    }
+
+    const std::vector<uint32_t>& frustum_culler_t::cull()
+    {
+        _visible.clear();
+
+        // pad to whole blocks of 8 with spheres of negative infinite radius, which fail every
+        // plane and the pixel size test
+        const uint32_t padded = (_count + 7) & ~7u;
+        _x.resize(padded, 0.0f);
+        _y.resize(padded, 0.0f);
+        _z.resize(padded, 0.0f);
+        _radius.resize(padded, -std::numeric_limits<float>::infinity());
+
+        auto compact = [&](uint32_t base, uint32_t mask)
+        {
+            while (mask != 0)
+            {
+                _visible.push_back(base + static_cast<uint32_t>(std::countr_zero(mask)));
+                mask &= mask - 1;
+            }
+        };
+
+#if defined(__AVX2__)
+        for (uint32_t i = 0; i < padded; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(&_x[i]);
+            const __m256 y = _mm256_loadu_ps(&_y[i]);
+            const __m256 z = _mm256_loadu_ps(&_z[i]);
+            const __m256 radius = _mm256_loadu_ps(&_radius[i]);
+            const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+            // a sphere is outside once it is fully behind one plane
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const glm::vec4& plane : _planes)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(plane.y)));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(plane.z)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            // radius * scale / depth >= minimum, multiplied out so spheres around the eye always pass
+            __m256 depth = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(_depth.x)), _mm256_set1_ps(_depth.w));
+            depth = _mm256_add_ps(depth, _mm256_mul_ps(y, _mm256_set1_ps(_depth.y)));
+            depth = _mm256_add_ps(depth, _mm256_mul_ps(z, _mm256_set1_ps(_depth.z)));
+            const __m256 size = _mm256_mul_ps(radius, _mm256_set1_ps(_pixelScale));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(size, _mm256_mul_ps(depth, _mm256_set1_ps(_minPixelSize)), _CMP_GE_OQ));
+
+            compact(i, static_cast<uint32_t>(_mm256_movemask_ps(inside)));
+        }
+#elif defined(FRUSTUM_CULLER_SSE2)
+        for (uint32_t i = 0; i < padded; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(&_x[i]);
+            const __m128 y = _mm_loadu_ps(&_y[i]);
+            const __m128 z = _mm_loadu_ps(&_z[i]);
+            const __m128 radius = _mm_loadu_ps(&_radius[i]);
+            const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : _planes)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+                distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+                distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            __m128 depth = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(_depth.x)), _mm_set1_ps(_depth.w));
+            depth = _mm_add_ps(depth, _mm_mul_ps(y, _mm_set1_ps(_depth.y)));
+            depth = _mm_add_ps(depth, _mm_mul_ps(z, _mm_set1_ps(_depth.z)));
+            const __m128 size = _mm_mul_ps(radius, _mm_set1_ps(_pixelScale));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(size, _mm_mul_ps(depth, _mm_set1_ps(_minPixelSize))));
+
+            compact(i, static_cast<uint32_t>(_mm_movemask_ps(inside)));
+        }
+#else
+        for (uint32_t i = 0; i < padded; ++i)
+        {
+            bool inside = true;
+            for (const glm::vec4& plane : _planes)
+                inside &= _x[i] * plane.x + plane.w + _y[i] * plane.y + _z[i] * plane.z >= -_radius[i];
+
+            const float depth = _x[i] * _depth.x + _depth.w + _y[i] * _depth.y + _z[i] * _depth.z;
+            inside &= _radius[i] * _pixelScale >= depth * _minPixelSize;
+
+            compact(i, inside ? 1u : 0u);
+        }
+#endif
+
+        // objects added after this keep their index
+        _x.resize(_count);
+        _y.resize(_count);
+        _z.resize(_count);
+        _radius.resize(_count);
+
+        return _visible;
+    }
+} // namespace eng
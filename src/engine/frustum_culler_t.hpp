@@ -0,0 +1,56 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace eng
+{
+    struct bounds_t;
+
+    // culls bounding spheres against the camera frustum and drops the ones that would cover less
+    // than a minimum number of pixels. spheres are kept structure of arrays and tested 8 at a
+    // time with AVX2, 4 with SSE, so the per object cost is a few instructions
+    class frustum_culler_t
+    {
+    public:
+        // planes are extracted from projection * view, viewportHeight is in pixels
+        void setCamera(const glm::mat4& projection, const glm::mat4& view, float viewportHeight);
+        // objects whose projected diameter is below this many pixels are dropped, 0 keeps all
+        void setMinPixelSize(float pixels) { _minPixelSize = pixels; }
+
+        // normals point inside, in the layout bvh_t::queryFrustum takes
+        const std::array<glm::vec4, 6>& planes() const { return _planes; }
+
+        // distance along the view direction, what the pixel size test divides by
+        float depth(const glm::vec3& point) const { return glm::dot(_depth, glm::vec4(point, 1.0f)); }
+
+        void clear();
+        // moves the local bounds into world space, the index of the object is its order of adding
+        void add(const glm::mat4& world, const bounds_t& bounds);
+
+        // returns the indices of the visible objects, ascending
+        const std::vector<uint32_t>& cull();
+    private:
+        // plane i is x * normal + w, positive inside
+        std::array<glm::vec4, 6> _planes{};
+        // clip space w of a point is the dot with this, the distance along the view direction
+        glm::vec4 _depth{0.0f};
+        // projected diameter is radius * _pixelScale / depth
+        float _pixelScale = 0.0f;
+        float _minPixelSize = 0.0f;
+
+        // padded to a multiple of 8 with spheres that are never visible while culling
+        std::vector<float> _x;
+        std::vector<float> _y;
+        std::vector<float> _z;
+        std::vector<float> _radius;
+        uint32_t _count = 0;
+
+        std::vector<uint32_t> _visible;
+    };
+} // namespace eng
@@ -0,0 +1,26 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "core/ecs.hpp"
+
+namespace eng
+{
+    // intrusive parent / child links, entities without one are roots. only edit through
+    // transform_system_t so depths and the sibling lists stay consistent
+    struct hierarchy_t
+    {
+        ecs::entity_id_t parent = ecs::null_entity_id;
+        ecs::entity_id_t firstChild = ecs::null_entity_id;
+        ecs::entity_id_t nextSibling = ecs::null_entity_id;
+        uint32_t depth = 0;
+    };
+
+    // cached parent * local matrix, written by transform_system_t
+    struct world_transform_t
+    {
+        glm::mat4 matrix{1.0f};
+    };
+} // namespace eng
@@ -47,10 +47,44 @@ namespace eng
         return attributeDescriptions;
     }
 
+    bounds_t model_t::computeBounds(const std::vector<vertex_t>& vertices)
+    {
+        bounds_t bounds;
+        if (vertices.empty())
+            return bounds;
+
+        bounds.min = bounds.max = vertices.front().translation;
+        for (const vertex_t& vertex : vertices)
+        {
+            bounds.min = glm::min(bounds.min, vertex.translation);
+            bounds.max = glm::max(bounds.max, vertex.translation);
+        }
+
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+        float radiusSquared = 0.0f;
+        for (const vertex_t& vertex : vertices)
+        {
+            const glm::vec3 offset = vertex.translation - bounds.center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+        }
+        bounds.radius = glm::sqrt(radiusSquared);
+
+        return bounds;
+    }
+
     // Model
 
     model_t::model_t(std::vector<vertex_t>& vertices, std::vector<uint32_t>& indices, std::string name)
-        : vertices(vertices), indices(indices), _name(name)
+        : model_t(vertices, indices, computeBounds(vertices), name)
+    {
+    }
+
+    model_t::model_t(std::vector<vertex_t>& vertices, std::vector<index_t>& indices, const bounds_t& bounds, std::string name)
+        : _vertices(std::make_shared<const std::vector<vertex_t>>(vertices)),
+          _indices(std::make_shared<const std::vector<index_t>>(indices)),
+          _bounds(bounds),
+          _name(name)
     {
         createVertexBuffer();
         createIndexBuffer();
@@ -69,16 +103,16 @@ namespace eng
         vkCmdBindIndexBuffer(cmd, _indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
     }
 
-    void model_t::draw(VkCommandBuffer cmd)
+    void model_t::draw(VkCommandBuffer cmd, uint32_t instanceCount, uint32_t firstInstance)
     {
-        vkCmdDrawIndexed(cmd, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        vkCmdDrawIndexed(cmd, static_cast<uint32_t>(_indices->size()), instanceCount, 0, 0, firstInstance);
     }
 
     void model_t::createVertexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(vertex_t) * vertices.size();
+        VkDeviceSize bufferSize = sizeof(vertex_t) * _vertices->size();
 
-        _vertexBuffer = std::make_unique<vk::vk_buffer>(vertices.data(),
+        _vertexBuffer = std::make_unique<vk::vk_buffer>(_vertices->data(),
                                     bufferSize,
                                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                     VMA_MEMORY_USAGE_CPU_TO_GPU);
@@ -86,9 +120,9 @@ namespace eng
 
     void model_t::createIndexBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(index_t) * indices.size();
+        VkDeviceSize bufferSize = sizeof(index_t) * _indices->size();
         
-        _indexBuffer = std::make_unique<vk::vk_buffer>(indices.data(),
+        _indexBuffer = std::make_unique<vk::vk_buffer>(_indices->data(),
                                     bufferSize,
                                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                                     VMA_MEMORY_USAGE_CPU_TO_GPU);
@@ -12,6 +12,8 @@
 #include "vk/vk_buffer.hpp"
 
 #include <array>
+#include <memory>
+#include <vector>
 #include "core/imageloader.hpp"
 
 namespace eng
@@ -22,6 +24,17 @@ namespace eng
         uint32_t channelId = UINT32_MAX;
     };
 
+    // bounds of a mesh in its own space, computed once at import
+    struct bounds_t
+    {
+        glm::vec3 min{0.0f};
+        glm::vec3 max{0.0f};
+
+        // sphere around the box center, looser than a minimal sphere but cheap to get
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+    };
+
     class model_t
     {
     public:
@@ -39,24 +52,44 @@ namespace eng
 
         using index_t = uint32_t;
 
+        static bounds_t computeBounds(const std::vector<vertex_t>& vertices);
+
         model_t() = default;
         model_t(std::vector<vertex_t>& vertices, std::vector<index_t>& indices, std::string name = "Joe Doe");
+        model_t(std::vector<vertex_t>& vertices, std::vector<index_t>& indices, const bounds_t& bounds, std::string name = "Joe Doe");
         ~model_t();
 
+        // keep moves cheap, pools move models around when they sort or swap-and-pop
+        model_t(const model_t&) = default;
+        model_t& operator=(const model_t&) = default;
+        model_t(model_t&&) noexcept = default;
+        model_t& operator=(model_t&&) noexcept = default;
+
         void bind(VkCommandBuffer cmd);
-        void draw(VkCommandBuffer cmd);
+        // instances read their data at gl_InstanceIndex, which starts at firstInstance
+        void draw(VkCommandBuffer cmd, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
 
         std::string name() const { return _name; }
+        const bounds_t& bounds() const { return _bounds; }
+
+        // models sharing a key share their vertex buffer and can skip rebinding
+        uintptr_t meshKey() const { return reinterpret_cast<uintptr_t>(_vertexBuffer.get()); }
+
+        const std::shared_ptr<const std::vector<vertex_t>>& vertices() const { return _vertices; }
+        const std::shared_ptr<const std::vector<index_t>>& indices() const { return _indices; }
     private:
         void createVertexBuffer();
         void createIndexBuffer();
 
-        std::vector<vertex_t> vertices;
-        std::vector<index_t> indices;
+        // immutable once loaded, copies of a model share the cpu data like the buffers
+        std::shared_ptr<const std::vector<vertex_t>> _vertices;
+        std::shared_ptr<const std::vector<index_t>> _indices;
 
         std::shared_ptr<vk::vk_buffer> _vertexBuffer;
         std::shared_ptr<vk::vk_buffer> _indexBuffer;
 
+        bounds_t _bounds;
+
         std::string _name = "Unknown Model";
     };
 
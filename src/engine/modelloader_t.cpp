@@ -4,10 +4,11 @@
 
 namespace eng
 {
-    Assimp::Importer modelloader_t::importer;
-
     bool modelloader_t::loadModel(const std::string& path, model_t* models)
     {
+        // one importer per call, the importer owns the returned scene so loads on different threads
+        // (worlds streaming their own assets) must not share it
+        Assimp::Importer importer;
         const aiScene *scene = importer.ReadFile(path,
         aiProcess_CalcTangentSpace |
         aiProcess_JoinIdenticalVertices |
@@ -65,7 +66,8 @@ namespace eng
 
         processVertices(mesh, vertices, indices);
 
-        model = model_t{vertices, indices};
+        // bounds are computed here once, culling only transforms them
+        model = model_t{vertices, indices, model_t::computeBounds(vertices)};
     }
 
     void modelloader_t::processVertices(aiMesh* mesh, std::vector<model_t::vertex_t>& vertices, std::vector<model_t::index_t>& indices)
@@ -18,8 +18,6 @@ namespace eng
     public:
         static bool loadModel(const std::string& path, model_t* models);
     private:
-        static Assimp::Importer importer;
-
         static void processScene(const aiScene* scene, std::vector<model_t>& models);
         static void processMesh(aiMesh* mesh, model_t& model);
         static void processVertices(aiMesh* mesh, std::vector<model_t::vertex_t>& vertices, std::vector<model_t::index_t>& indices);
@@ -0,0 +1,97 @@
+#include "render_queue_t.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace eng
+{
+    render_queue_t::render_queue_t(core::job_system_t& jobSystem)
+        : _jobSystem(jobSystem)
+    {
+    }
+
+    uint64_t render_queue_t::makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth)
+    {
+        assert(pass < (1u << passBits) && pipeline < (1u << pipelineBits) && material < (1u << materialBits));
+        assert(mesh < (1u << meshBits) && depth < (1u << depthBits));
+
+        uint64_t key = pass;
+        key = (key << pipelineBits) | pipeline;
+        key = (key << materialBits) | material;
+        key = (key << meshBits) | mesh;
+        key = (key << depthBits) | depth;
+        return key;
+    }
+
+    uint32_t render_queue_t::quantizeDepth(float depth)
+    {
+        // behind the camera and nan both go first
+        if (!(depth > 0.0f))
+            return 0;
+
+        // the sign bit is always clear, so 8 exponent and 8 mantissa bits remain
+        return std::bit_cast<uint32_t>(depth) >> (31 - depthBits);
+    }
+
+    void render_queue_t::sort()
+    {
+        const uint32_t count = size();
+        if (count < 2)
+            return;
+
+        const uint32_t threads = _jobSystem.threadCount();
+        const uint32_t grainSize = std::max(minGrainSize, (count + threads - 1) / threads);
+        const uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+        _histograms.resize(chunkCount);
+        _varying.assign(chunkCount, 0);
+        _scratch.resize(count);
+
+        // bits that differ from the first key somewhere
+        const uint64_t firstKey = _items[0].key;
+        _jobSystem.parallelFor(count, grainSize, [&](uint32_t begin, uint32_t end) {
+            uint64_t varying = 0;
+            for (uint32_t i = begin; i < end; ++i)
+                varying |= _items[i].key ^ firstKey;
+            _varying[begin / grainSize] = varying;
+        });
+
+        uint64_t varying = 0;
+        for (uint64_t chunkVarying : _varying)
+            varying |= chunkVarying;
+
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            if (((varying >> shift) & 0xff) == 0)
+                continue;
+
+            _jobSystem.parallelFor(count, grainSize, [&](uint32_t begin, uint32_t end) {
+                std::array<uint32_t, 256>& histogram = _histograms[begin / grainSize];
+                histogram.fill(0);
+                for (uint32_t i = begin; i < end; ++i)
+                    ++histogram[(_items[i].key >> shift) & 0xff];
+            });
+
+            // digit major, chunk minor: equal digits keep the order of their chunks, so the sort is stable
+            uint32_t offset = 0;
+            for (uint32_t digit = 0; digit < 256; ++digit)
+            {
+                for (std::array<uint32_t, 256>& histogram : _histograms)
+                {
+                    const uint32_t digitCount = histogram[digit];
+                    histogram[digit] = offset;
+                    offset += digitCount;
+                }
+            }
+
+            _jobSystem.parallelFor(count, grainSize, [&](uint32_t begin, uint32_t end) {
+                std::array<uint32_t, 256>& offsets = _histograms[begin / grainSize];
+                for (uint32_t i = begin; i < end; ++i)
+                    _scratch[offsets[(_items[i].key >> shift) & 0xff]++] = _items[i];
+            });
+
+            _items.swap(_scratch);
+        }
+    }
+} // namespace eng
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "core/job_system.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace eng
+{
+    // the draws of a scene as 64 bit sort keys, so draws sharing state end up next to each other
+    // and the recorder only binds when something changes. from the most significant bits down a
+    // key holds the pass, pipeline, material, mesh and a quantized depth
+    class render_queue_t
+    {
+    public:
+        struct item_t
+        {
+            uint64_t key;
+            // index into the caller's draw list
+            uint32_t draw;
+        };
+
+        static constexpr uint32_t passBits = 4;
+        static constexpr uint32_t pipelineBits = 8;
+        static constexpr uint32_t materialBits = 16;
+        static constexpr uint32_t meshBits = 20;
+        static constexpr uint32_t depthBits = 16;
+        static_assert(passBits + pipelineBits + materialBits + meshBits + depthBits == 64);
+
+        static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth);
+
+        static uint32_t pass(uint64_t key) { return field(key, depthBits + meshBits + materialBits + pipelineBits, passBits); }
+        static uint32_t pipeline(uint64_t key) { return field(key, depthBits + meshBits + materialBits, pipelineBits); }
+        static uint32_t material(uint64_t key) { return field(key, depthBits + meshBits, materialBits); }
+        static uint32_t mesh(uint64_t key) { return field(key, depthBits, meshBits); }
+        static uint32_t depth(uint64_t key) { return field(key, 0, depthBits); }
+
+        // everything but the depth, draws with equal state can share one draw call
+        static uint64_t state(uint64_t key) { return key >> depthBits; }
+
+        // view depth to the depth field, monotonic and finer close to the camera. the upper bits of
+        // a positive float already order like the float, no near and far planes needed
+        static uint32_t quantizeDepth(float depth);
+
+        explicit render_queue_t(core::job_system_t& jobSystem = core::job_system_t::getInstance());
+
+        void clear() { _items.clear(); }
+        void push(uint64_t key, uint32_t draw) { _items.push_back({key, draw}); }
+
+        // stable LSD radix sort, a byte per pass. chunks build their histograms and scatter in
+        // parallel, bytes that are equal in every key (usually pass and pipeline) are skipped
+        void sort();
+
+        const std::vector<item_t>& items() const { return _items; }
+        uint32_t size() const { return static_cast<uint32_t>(_items.size()); }
+    private:
+        static uint32_t field(uint64_t key, uint32_t shift, uint32_t bits)
+        {
+            return static_cast<uint32_t>((key >> shift) & ((uint64_t(1) << bits) - 1));
+        }
+
+        // below this many keys per chunk the workers cost more than they save
+        static constexpr uint32_t minGrainSize = 4096;
+
+        core::job_system_t& _jobSystem;
+
+        std::vector<item_t> _items;
+        std::vector<item_t> _scratch;
+
+        // per chunk
+        std::vector<std::array<uint32_t, 256>> _histograms;
+        std::vector<uint64_t> _varying;
+    };
+} // namespace eng
@@ -0,0 +1,85 @@
+#include "spatial_system_t.hpp"
+
+namespace eng
+{
+    spatial_system_t::spatial_system_t(ecs::scene_t<>& scene)
+        : _scene(scene)
+    {
+        // losing either component takes the entity out of the tree
+        _scene.on_destroy<model_t>().connect<&spatial_system_t::onDestroy>(*this);
+        _scene.on_destroy<world_transform_t>().connect<&spatial_system_t::onDestroy>(*this);
+    }
+
+    spatial_system_t::~spatial_system_t()
+    {
+        _scene.on_destroy<model_t>().disconnect(this);
+        _scene.on_destroy<world_transform_t>().disconnect(this);
+    }
+
+    void spatial_system_t::update()
+    {
+        const ecs::tick_t current = _scene.tick();
+
+        // an entity becomes renderable with whichever of both components it got last
+        for (auto [id, model, world] : _scene.view<model_t, world_transform_t>().added_since<model_t>(_lastTick))
+            insert(id, model, world);
+        for (auto [id, model, world] : _scene.view<model_t, world_transform_t>().added_since<world_transform_t>(_lastTick))
+            insert(id, model, world);
+
+        for (auto [id, world] : _scene.view<world_transform_t>().changed_since(_lastTick))
+        {
+            bvh_t::proxy_t proxy = proxyOf(id);
+            if (proxy != bvh_t::null_proxy)
+                _bvh.update(proxy, worldBounds(_scene.get<model_t>(id), world));
+        }
+        for (auto [id, model] : _scene.view<model_t>().changed_since(_lastTick))
+        {
+            bvh_t::proxy_t proxy = proxyOf(id);
+            if (proxy != bvh_t::null_proxy)
+                _bvh.update(proxy, worldBounds(model, _scene.get<world_transform_t>(id)));
+        }
+
+        _bvh.refit();
+        if (++_updates % rebuildInterval == 0)
+            _bvh.rebuildPartial();
+
+        // world_t::update advances the tick after the systems ran, later writes carry a newer one
+        _lastTick = current;
+    }
+
+    void spatial_system_t::insert(ecs::entity_id_t id, const model_t& model, const world_transform_t& world)
+    {
+        bvh_t::proxy_t& proxy = proxyOf(id);
+        if (proxy == bvh_t::null_proxy)
+            proxy = _bvh.insert(worldBounds(model, world), id);
+    }
+
+    ecs::entity_id_t spatial_system_t::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+    {
+        bvh_t::ray_hit_t hit = _bvh.raycast(origin, direction, maxDistance);
+        return hit.hit() ? hit.user : ecs::null_entity_id;
+    }
+
+    void spatial_system_t::onDestroy(ecs::scene_t<>&, ecs::entity_id_t id)
+    {
+        bvh_t::proxy_t& proxy = proxyOf(id);
+        if (proxy == bvh_t::null_proxy)
+            return;
+
+        _bvh.remove(proxy);
+        proxy = bvh_t::null_proxy;
+    }
+
+    aabb_t spatial_system_t::worldBounds(const model_t& model, const world_transform_t& world) const
+    {
+        return aabb_t::transform({model.bounds().min, model.bounds().max}, world.matrix);
+    }
+
+    bvh_t::proxy_t& spatial_system_t::proxyOf(ecs::entity_id_t id)
+    {
+        const uint32_t index = ecs::entity_index(id);
+        if (index >= _proxies.size())
+            _proxies.resize(index + 1, bvh_t::null_proxy);
+        return _proxies[index];
+    }
+} // namespace eng
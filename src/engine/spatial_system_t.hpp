@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/ecs.hpp"
+#include "engine/components.hpp"
+#include "engine/bvh_t.hpp"
+#include "engine/hierarchy_t.hpp"
+#include "engine/model_t.hpp"
+
+#include <limits>
+#include <vector>
+
+namespace eng
+{
+    // keeps a bvh over the renderable entities (model_t plus world_transform_t) of a scene. leaves
+    // are refit when world matrices or models change, and every few updates one subtree is rebuilt
+    // to undo what refitting costs the tree's quality. run it after the transform system
+    class spatial_system_t
+    {
+    public:
+        explicit spatial_system_t(ecs::scene_t<>& scene);
+        ~spatial_system_t();
+
+        spatial_system_t(const spatial_system_t&) = delete;
+        spatial_system_t& operator=(const spatial_system_t&) = delete;
+
+        void update();
+
+        // leaves hold entity ids, in world space
+        const bvh_t& bvh() const { return _bvh; }
+
+        // closest renderable whose bounds the ray enters, null_entity_id on a miss
+        ecs::entity_id_t raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                 float maxDistance = std::numeric_limits<float>::infinity()) const;
+    private:
+        void onDestroy(ecs::scene_t<>& scene, ecs::entity_id_t id);
+        void insert(ecs::entity_id_t id, const model_t& model, const world_transform_t& world);
+
+        aabb_t worldBounds(const model_t& model, const world_transform_t& world) const;
+        bvh_t::proxy_t& proxyOf(ecs::entity_id_t id);
+
+        // updates between two partial rebuilds
+        static constexpr uint32_t rebuildInterval = 16;
+
+        ecs::scene_t<>& _scene;
+        ecs::tick_t _lastTick = 0;
+
+        bvh_t _bvh;
+        // leaf of every entity in the tree, by entity index
+        std::vector<bvh_t::proxy_t> _proxies;
+        uint32_t _updates = 0;
+    };
+} // namespace eng
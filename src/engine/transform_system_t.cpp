@@ -0,0 +1,200 @@
+#include "transform_system_t.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace eng
+{
+    transform_system_t::transform_system_t(ecs::scene_t<>& scene)
+        : _scene(scene)
+    {
+        _scene.on_destroy<hierarchy_t>().connect<&transform_system_t::onDestroy>(*this);
+
+        // render reads the matrices published by the last swap_buffers
+        _scene.double_buffer<world_transform_t>();
+    }
+
+    transform_system_t::~transform_system_t()
+    {
+        _scene.on_destroy<hierarchy_t>().disconnect(this);
+    }
+
+    void transform_system_t::setParent(ecs::entity_id_t child, ecs::entity_id_t parent)
+    {
+        assert(_scene.valid(child) && child != parent);
+
+        // construct before taking references, construction may move the pool
+        if (!_scene.has<hierarchy_t>(child))
+            _scene.construct<hierarchy_t>(child);
+
+        if (parent != ecs::null_entity_id)
+        {
+            assert(_scene.valid(parent));
+            if (!_scene.has<hierarchy_t>(parent))
+                _scene.construct<hierarchy_t>(parent);
+
+            for (ecs::entity_id_t ancestor = parent; ancestor != ecs::null_entity_id; ancestor = _scene.get<hierarchy_t>(ancestor).parent)
+                assert(ancestor != child && "cannot parent an entity to its own descendant");
+        }
+
+        unlink(child);
+
+        uint32_t depth = 0;
+        if (parent != ecs::null_entity_id)
+        {
+            hierarchy_t& parentNode = _scene.get<hierarchy_t>(parent);
+            hierarchy_t& node = _scene.get<hierarchy_t>(child);
+
+            node.parent = parent;
+            node.nextSibling = parentNode.firstChild;
+            parentNode.firstChild = child;
+            depth = parentNode.depth + 1;
+        }
+
+        updateDepths(child, depth);
+        _scene.mark_changed<hierarchy_t>(child);
+    }
+
+    void transform_system_t::update()
+    {
+        const ecs::tick_t current = _scene.tick();
+        ++_pass;
+        _dirty.clear();
+
+        // every transform gets a cached world matrix, new ones start dirty
+        _queue.clear();
+        for (auto [id, transform] : _scene.view<transform_t>(ecs::exclude<world_transform_t>))
+            _queue.push_back(id);
+        for (ecs::entity_id_t id : _queue)
+        {
+            _scene.construct<world_transform_t>(id);
+            markDirty(id);
+        }
+
+        for (auto [id, transform] : _scene.view<transform_t>().changed_since(_lastTick))
+            markDirty(id);
+        for (auto [id, node] : _scene.view<hierarchy_t>().changed_since(_lastTick))
+            markDirty(id);
+
+        if (!_dirty.empty())
+        {
+            // keep the nodes depth sorted, the order barely changes between updates
+            _scene.sort<hierarchy_t>([](const hierarchy_t& a, const hierarchy_t& b) { return a.depth < b.depth; },
+                ecs::sort_mode_t::insertion);
+
+            // parents come before their children, so one linear walk sees every parent final and
+            // a dirty parent dirties its whole subtree on the way
+            for (auto [id, node] : _scene.view<hierarchy_t>())
+            {
+                if (node.parent != ecs::null_entity_id && isDirty(node.parent))
+                    markDirty(id);
+                if (!isDirty(id) || !_scene.has<world_transform_t>(id))
+                    continue;
+
+                glm::mat4 parentMatrix(1.0f);
+                if (node.parent != ecs::null_entity_id && _scene.has<world_transform_t>(node.parent))
+                    parentMatrix = _scene.get<world_transform_t>(node.parent).matrix;
+                updateWorld(id, parentMatrix);
+            }
+
+            // the rest are not linked to anything, their world matrix is their local one
+            for (ecs::entity_id_t id : _dirty)
+                if (!_scene.has<hierarchy_t>(id) && _scene.has<world_transform_t>(id))
+                    updateWorld(id, glm::mat4(1.0f));
+        }
+
+        // world_t::update advances the tick after the systems ran, later writes carry a newer one
+        _lastTick = current;
+    }
+
+    void transform_system_t::updateWorld(ecs::entity_id_t id, const glm::mat4& parentMatrix)
+    {
+        glm::mat4 local = _scene.has<transform_t>(id) ? _scene.get<transform_t>(id).mat4() : glm::mat4(1.0f);
+        _scene.patch<world_transform_t>(id, [&](world_transform_t& world) {
+            world.matrix = parentMatrix * local;
+        });
+    }
+
+    void transform_system_t::markDirty(ecs::entity_id_t id)
+    {
+        uint32_t index = ecs::entity_index(id);
+        if (index >= _dirtyPass.size())
+            _dirtyPass.resize(index + 1, 0);
+        if (_dirtyPass[index] == _pass)
+            return;
+
+        _dirtyPass[index] = _pass;
+        _dirty.push_back(id);
+    }
+
+    bool transform_system_t::isDirty(ecs::entity_id_t id) const
+    {
+        uint32_t index = ecs::entity_index(id);
+        return index < _dirtyPass.size() && _dirtyPass[index] == _pass;
+    }
+
+    void transform_system_t::onDestroy(ecs::scene_t<>& scene, ecs::entity_id_t id)
+    {
+        unlink(id);
+
+        // orphaned children become roots, only their components change so this is safe
+        // inside the signal
+        hierarchy_t& node = scene.get<hierarchy_t>(id);
+        ecs::entity_id_t child = node.firstChild;
+        node.firstChild = ecs::null_entity_id;
+
+        while (child != ecs::null_entity_id)
+        {
+            hierarchy_t& childNode = scene.get<hierarchy_t>(child);
+            ecs::entity_id_t next = childNode.nextSibling;
+
+            childNode.parent = ecs::null_entity_id;
+            childNode.nextSibling = ecs::null_entity_id;
+            updateDepths(child, 0);
+            scene.mark_changed<hierarchy_t>(child);
+
+            child = next;
+        }
+    }
+
+    void transform_system_t::unlink(ecs::entity_id_t child)
+    {
+        hierarchy_t& node = _scene.get<hierarchy_t>(child);
+        if (node.parent == ecs::null_entity_id)
+            return;
+
+        hierarchy_t& parentNode = _scene.get<hierarchy_t>(node.parent);
+        if (parentNode.firstChild == child)
+        {
+            parentNode.firstChild = node.nextSibling;
+        }
+        else
+        {
+            ecs::entity_id_t sibling = parentNode.firstChild;
+            while (_scene.get<hierarchy_t>(sibling).nextSibling != child)
+                sibling = _scene.get<hierarchy_t>(sibling).nextSibling;
+            _scene.get<hierarchy_t>(sibling).nextSibling = node.nextSibling;
+        }
+
+        node.parent = ecs::null_entity_id;
+        node.nextSibling = ecs::null_entity_id;
+    }
+
+    void transform_system_t::updateDepths(ecs::entity_id_t root, uint32_t depth)
+    {
+        _scene.get<hierarchy_t>(root).depth = depth;
+
+        std::vector<ecs::entity_id_t> queue{root};
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            const hierarchy_t& node = _scene.get<hierarchy_t>(queue[head]);
+            for (ecs::entity_id_t child = node.firstChild; child != ecs::null_entity_id;)
+            {
+                hierarchy_t& childNode = _scene.get<hierarchy_t>(child);
+                childNode.depth = node.depth + 1;
+                queue.push_back(child);
+                child = childNode.nextSibling;
+            }
+        }
+    }
+} // namespace eng
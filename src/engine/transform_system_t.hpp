@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/ecs.hpp"
+#include "engine/components.hpp"
+#include "engine/transform_t.hpp"
+#include "engine/hierarchy_t.hpp"
+
+#include <vector>
+
+namespace eng
+{
+    // keeps world_transform_t in sync with transform_t and the hierarchy. update only recomputes
+    // the subtrees whose local transform or links changed since the last update. hierarchy_t is
+    // kept sorted by depth, so a linear walk over it finishes every parent before its children.
+    // world_transform_t is double buffered, readers outside the simulation use the front copy
+    class transform_system_t
+    {
+    public:
+        explicit transform_system_t(ecs::scene_t<>& scene);
+        ~transform_system_t();
+
+        transform_system_t(const transform_system_t&) = delete;
+        transform_system_t& operator=(const transform_system_t&) = delete;
+
+        // structural, call it outside of any iteration. a null parent detaches the child
+        void setParent(ecs::entity_id_t child, ecs::entity_id_t parent);
+
+        void update();
+    private:
+        void onDestroy(ecs::scene_t<>& scene, ecs::entity_id_t id);
+
+        void unlink(ecs::entity_id_t child);
+        void updateDepths(ecs::entity_id_t root, uint32_t depth);
+        void updateWorld(ecs::entity_id_t id, const glm::mat4& parentMatrix);
+
+        // dirty means marked during the current pass, so nothing has to be cleared
+        void markDirty(ecs::entity_id_t id);
+        bool isDirty(ecs::entity_id_t id) const;
+
+        ecs::scene_t<>& _scene;
+        ecs::tick_t _lastTick = 0;
+
+        // scratch kept between updates to avoid reallocating
+        std::vector<ecs::entity_id_t> _dirty;
+        std::vector<ecs::entity_id_t> _queue;
+
+        // last update pass that marked an entity dirty, by entity index
+        std::vector<uint32_t> _dirtyPass;
+        uint32_t _pass = 0;
+    };
+} // namespace eng
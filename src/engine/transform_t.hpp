@@ -42,7 +42,7 @@ namespace eng
 
         glm::vec3 getRotationEuler() const { return glm::eulerAngles(rotation); }
 
-        glm::mat4 mat4()
+        glm::mat4 mat4() const
         {
             glm::mat4 matrix(1.0f);
 
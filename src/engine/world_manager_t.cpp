@@ -0,0 +1,57 @@
+#include "world_manager_t.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace eng
+{
+    world_manager_t::world_manager_t(core::job_system_t& jobSystem)
+        : _jobSystem(jobSystem)
+    {
+    }
+
+    world_t& world_manager_t::createWorld(std::string name)
+    {
+        return *_worlds.emplace_back(std::make_unique<world_t>(std::move(name), _jobSystem));
+    }
+
+    void world_manager_t::destroyWorld(world_t& world)
+    {
+        auto it = std::find_if(_worlds.begin(), _worlds.end(),
+            [&](const std::unique_ptr<world_t>& candidate) { return candidate.get() == &world; });
+
+        assert(it != _worlds.end() && "world belongs to another manager");
+        _worlds.erase(it);
+    }
+
+    world_t* world_manager_t::findWorld(std::string_view name)
+    {
+        for (auto& world : _worlds)
+            if (world->name() == name)
+                return world.get();
+
+        return nullptr;
+    }
+
+    void world_manager_t::update()
+    {
+        _running.clear();
+        for (auto& world : _worlds)
+            if (!world->paused)
+                _running.push_back(world.get());
+
+        // a world per chunk, systems inside a world may still split their own work on the same pool
+        _jobSystem.parallelFor(static_cast<uint32_t>(_running.size()), 1, [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+                _running[i]->update();
+        });
+    }
+
+    void world_manager_t::render(vk::vk_renderer& renderer)
+    {
+        for (auto& world : _worlds)
+            if (world->visible)
+                renderer.renderScene(world->scene(), &world->spatialSystem().bvh());
+    }
+} // namespace eng
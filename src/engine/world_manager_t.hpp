@@ -0,0 +1,45 @@
+#pragma once
+
+#include "engine/world_t.hpp"
+#include "core/job_system.hpp"
+#include "vk/vk_renderer.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace eng
+{
+    // owns every world of the engine: the edited level, play mode copies, previews and so on.
+    // worlds are heap allocated so references stay valid while others are created or destroyed
+    class world_manager_t
+    {
+    public:
+        explicit world_manager_t(core::job_system_t& jobSystem = core::job_system_t::getInstance());
+
+        world_manager_t(const world_manager_t&) = delete;
+        world_manager_t& operator=(const world_manager_t&) = delete;
+
+        world_t& createWorld(std::string name);
+        void destroyWorld(world_t& world);
+
+        // nullptr when no world has that name
+        world_t* findWorld(std::string_view name);
+
+        // steps every world that is not paused, one job per world. nothing may read or write
+        // another world from inside an update
+        void update();
+
+        // draws every visible world into the pass that is currently recording
+        void render(vk::vk_renderer& renderer);
+
+        const std::vector<std::unique_ptr<world_t>>& worlds() const { return _worlds; }
+    private:
+        core::job_system_t& _jobSystem;
+        std::vector<std::unique_ptr<world_t>> _worlds;
+
+        // scratch kept between updates to avoid reallocating
+        std::vector<world_t*> _running;
+    };
+} // namespace eng
@@ -0,0 +1,25 @@
+#include "world_t.hpp"
+
+namespace eng
+{
+    world_t::world_t(std::string name, core::job_system_t& jobSystem)
+        : _name(std::move(name)), _commands(jobSystem)
+    {
+    }
+
+    void world_t::update()
+    {
+        _commands.playback(_scene);
+
+        _transformSystem.update();
+        // reads the world matrices the transform system just wrote
+        _spatialSystem.update();
+
+        // frame boundary, readers only see the published copies from here on
+        _scene.swap_buffers();
+
+        // the one tick advance per frame. the systems handled everything stamped with the current
+        // tick, edits made until the next update get the new one
+        _scene.advance_tick();
+    }
+} // namespace eng
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/ecs.hpp"
+#include "core/job_system.hpp"
+#include "engine/transform_system_t.hpp"
+#include "engine/spatial_system_t.hpp"
+
+#include <string>
+
+namespace eng
+{
+    // one independent simulation: its scene, the edits deferred to its next step and the systems
+    // running on it. worlds share no mutable state, so two worlds can step on different threads
+    class world_t
+    {
+    public:
+        explicit world_t(std::string name, core::job_system_t& jobSystem = core::job_system_t::getInstance());
+
+        world_t(const world_t&) = delete;
+        world_t& operator=(const world_t&) = delete;
+
+        // applies the recorded edits, runs the systems and publishes the double buffered state
+        void update();
+
+        ecs::scene_t<>& scene() { return _scene; }
+        ecs::thread_command_buffers_t<>& commands() { return _commands; }
+        transform_system_t& transformSystem() { return _transformSystem; }
+        spatial_system_t& spatialSystem() { return _spatialSystem; }
+
+        const std::string& name() const { return _name; }
+
+        // paused worlds are skipped by world_manager_t::update, hidden ones by world_manager_t::render
+        bool paused = false;
+        bool visible = true;
+    private:
+        std::string _name;
+
+        ecs::scene_t<> _scene;
+        // structural edits made while the world is read, applied at the start of the next update
+        ecs::thread_command_buffers_t<> _commands;
+        transform_system_t _transformSystem{_scene};
+        spatial_system_t _spatialSystem{_scene};
+    };
+} // namespace eng
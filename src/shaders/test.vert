@@ -1,9 +1,10 @@
 #version 450
 
+#extension GL_EXT_nonuniform_qualifier : enable
+
 layout(push_constant) uniform PushConstant 
 {
-    mat4 modelMatrix;
-    uint textureId;
+    uint instanceBuffer;
 } push;
 
 layout(location = 0) in vec3 position;
@@ -15,17 +16,32 @@ layout(location = 4) in vec3 tangent;
 layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec4 fragColor;
 layout(location = 2) out vec2 fragUV;
+layout(location = 3) flat out uint fragTextureId;
 
 layout(set = 0, binding = 0) uniform globalBuffer {
     mat4 projection;
     mat4 view;
 } global; 
 
+// matches vk::instance_t, written once per frame by the renderer
+struct instance_t
+{
+    mat4 modelMatrix;
+    uint textureId;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceBuffer {
+    instance_t instances[];
+} instanceBuffers[];
+
 void main()
 {
-    gl_Position = (global.projection * global.view) * push.modelMatrix * vec4(position, 1.0f);
+    instance_t instance = instanceBuffers[push.instanceBuffer].instances[gl_InstanceIndex];
+
+    gl_Position = (global.projection * global.view) * instance.modelMatrix * vec4(position, 1.0f);
     
     fragColor = vec4(color, 1.0f);
-    fragNormal = normalize(mat3(push.modelMatrix) * normal);
+    fragNormal = normalize(mat3(instance.modelMatrix) * normal);
     fragUV = uv;
+    fragTextureId = instance.textureId;
 }
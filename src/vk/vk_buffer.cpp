@@ -1,6 +1,7 @@
 #include "vk_buffer.hpp"
 
 #include <iostream>
+#include <cassert>
 
 namespace vk
 {
@@ -38,4 +39,18 @@ namespace vk
     {
         vmaDestroyBuffer(vk_context::allocator, _buffer, _allocation);
     }
+
+    void vk_buffer::write(const void* data, VkDeviceSize size, VkDeviceSize offset)
+    {
+        assert(offset + size <= _size && "write past the end of the buffer");
+
+        void* mapped = nullptr;
+        if (vmaMapMemory(vk_context::allocator, _allocation, &mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map Vulkan buffer memory");
+        }
+
+        memcpy(static_cast<char*>(mapped) + offset, data, static_cast<size_t>(size));
+        vmaUnmapMemory(vk_context::allocator, _allocation);
+    }
 } // namespace vk
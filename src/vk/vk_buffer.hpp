@@ -26,6 +26,11 @@ namespace vk
             memcpy(_mapped, newData, static_cast<size_t>(_size));
         }
 
+        // copies size bytes to offset, the memory has to be host visible
+        void write(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
+
+        VkDeviceSize size() const { return _size; }
+
         void bindUniform(VkCommandBuffer cmd, VkPipelineLayout layout, 
                         std::unique_ptr<vk_device>& _device, 
                         vk_channelindices& channelInfo)
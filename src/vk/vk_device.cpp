@@ -71,6 +71,13 @@ namespace vk
         VkPhysicalDeviceFeatures deviceFeatures{};
         deviceFeatures.samplerAnisotropy = VK_TRUE; 
 
+        // optional, the renderer falls back to one draw per batch without them
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(_physical_device, &supportedFeatures);
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+        _multiDrawIndirect = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+
         VkPhysicalDeviceBufferDeviceAddressFeatures bdaFeatures{};
         bdaFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
         bdaFeatures.bufferDeviceAddress = VK_TRUE;
@@ -86,6 +93,7 @@ namespace vk
         indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
         indexingFeatures.shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
         indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
         indexingFeatures.pNext = &bdaFeatures;
         
         VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeature{};
@@ -261,6 +269,20 @@ namespace vk
             layoutInfo.bindingCount = 1;
             layoutInfo.pBindings = &binding;
 
+            // storage buffers grow while frames that bind the set are still recording or in flight
+            VkDescriptorBindingFlags storageFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+
+            VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{};
+            bindingFlags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlags.bindingCount = 1;
+            bindingFlags.pBindingFlags = &storageFlags;
+
+            if (binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            {
+                layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+                layoutInfo.pNext = &bindingFlags;
+            }
+
             if (vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_setLayouts[i]) != VK_SUCCESS)
             {
                 throw std::runtime_error("Failed to create descriptor set layout at index " + std::to_string(i));
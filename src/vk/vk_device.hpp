@@ -64,6 +64,9 @@ namespace vk
         
         static VkPhysicalDeviceLimits limits() { return _properties.limits; }
 
+        // many draws per vkCmdDrawIndexedIndirect, each with its own firstInstance
+        bool supportsMultiDrawIndirect() const { return _multiDrawIndirect; }
+
         constexpr vk_channelinfo getChannelInfo() {
             vk_channelinfo channelInfo;
             channelInfo.uniformIndices.reserve(numUniform);
@@ -108,8 +111,10 @@ namespace vk
 
         QueueFamilyIndices _queueFamilies;
 
+        bool _multiDrawIndirect = false;
+
         const uint32_t numUniform = 1;
-        const uint32_t numSSBO = 0;
+        const uint32_t numSSBO = 1;
         const uint32_t numCombinedImageSampler = 1;
         const uint32_t numChannels = numUniform + numSSBO + numCombinedImageSampler;
 
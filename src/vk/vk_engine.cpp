@@ -49,8 +49,9 @@ namespace vk
         device = std::make_unique<vk_device>(context);
         swapchain = std::make_unique<vk_swapchain>(device, context);
 
-        const std::string pathToVertex = "C:\\Users\\gabri\\OneDrive\\Documentos\\GitHub\\VulkanSetup\\src\\shaders\\test.vert.spv";
-        const std::string pathToFragment = "C:\\Users\\gabri\\OneDrive\\Documentos\\GitHub\\VulkanSetup\\src\\shaders\\test.frag.spv";
+        // compiled into the build tree by the shaders target
+        const std::string pathToVertex = ENGINE_SHADER_DIR "test.vert.spv";
+        const std::string pathToFragment = ENGINE_SHADER_DIR "test.frag.spv";
 
         pipelineCreateInfo pipelineInfo{};
         vk_pipeline::defaultPipelineCreateInfo(pipelineInfo);
@@ -178,7 +179,19 @@ namespace vk
 
     void vk_engine::setupBaseScene()
     {
-        renderer->setScene(_scene);
+        ecs::scene_t<>& templates = _prefabs.templates();
+        ecs::entity_id_t suzanne = _prefabs.create();
+
+        auto& model = templates.construct<eng::model_t>(suzanne);
+        eng::modelloader_t::loadModel("C:\\Users\\gabri\\OneDrive\\Documentos\\GitHub\\VulkanSetup\\src\\resource\\suzane.obj", &model);
+        
+        templates.construct<core::name_t>(suzanne, "Suzane");
+
+        eng::transform_t transform{};
+        transform.translation = {0.f, 0.f, 2.0f};
+        transform.applyRotation(glm::vec3(0.f, 180.0f, 0.f));
+
+        _prefabs.instantiate<eng::transform_t>(_scene, suzanne, std::span<const eng::transform_t>(&transform, 1));
     }
 
     ImVec2 previousWindowSize = {0.0f, 0.0f};
@@ -218,6 +231,28 @@ namespace vk
         if (_currentImage)
         {
             ImGui::Image(reinterpret_cast<ImTextureID>(_currentImage), currentSize);
+
+            // clicking the viewport selects the closest object under the cursor
+            if (ImGui::IsItemClicked(ImGuiMouseButton_Left))
+            {
+                ImVec2 imageMin = ImGui::GetItemRectMin();
+                ImVec2 imageSize = ImGui::GetItemRectSize();
+                ImVec2 mouse = ImGui::GetMousePos();
+
+                glm::vec2 ndc = { 2.0f * (mouse.x - imageMin.x) / imageSize.x - 1.0f,
+                                  2.0f * (mouse.y - imageMin.y) / imageSize.y - 1.0f };
+
+                glm::mat4 inverseViewProjection = glm::inverse(cam.getProjection() * cam.getView());
+                glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc, 0.0f, 1.0f);
+                glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+
+                glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+                glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+                ecs::entity_id_t picked = _world.spatialSystem().raycast(origin, direction);
+                if (picked != ecs::null_entity_id)
+                    _currentlySelected = picked;
+            }
         }
         ImGui::End();
 
@@ -338,16 +373,14 @@ namespace vk
 
                     if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
                     {
-                        if (!_scene.has<eng::texture_t>(_currentlySelected)) 
-                            _scene.construct<eng::texture_t>(_currentlySelected);
-                                    
                         vk::vk_channelindices indices = assetHandler->getIndices(pair.first);
 
                         eng::texture_t tex;
                         tex.channelId = indices.channelIndex;
                         tex.id = indices.index;
 
-                        _scene.get<eng::texture_t>(_currentlySelected) = tex;
+                        // replaces the current texture if there is one
+                        _world.commands().local().emplace<eng::texture_t>(_currentlySelected, tex);
                         _currentlySelectedComponent = UINT32_MAX;
                         ImGui::CloseCurrentPopup();
                     }
@@ -384,10 +417,7 @@ namespace vk
 
                     if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left))
                     {
-                        if (!_scene.has<eng::model_t>(_currentlySelected))
-                            _scene.construct<eng::model_t>(_currentlySelected);
-
-                        _scene.get<eng::model_t>(_currentlySelected) = assetHandler->getModel(pair.first);
+                        _world.commands().local().emplace<eng::model_t>(_currentlySelected, assetHandler->getModel(pair.first));
                         _currentlySelectedComponent = UINT32_MAX;
                         ImGui::CloseCurrentPopup();
                     }
@@ -406,6 +436,11 @@ namespace vk
     {
         ImGui::Begin("Console");
 
+        const vk::render_stats_t& stats = renderer->stats();
+        ImGui::Text("Draws: %u in %u draw calls", stats.draws, stats.drawCalls);
+        ImGui::Text("Pipeline binds: %u, descriptor binds: %u", stats.pipelineBinds, stats.descriptorBinds);
+        ImGui::Text("Vertex buffer binds: %u, avoided: %u", stats.vertexBufferBinds, stats.vertexBufferBindsAvoided);
+
         ImGui::End();
     }
 
@@ -449,11 +484,12 @@ namespace vk
         ImGui::Text("Translation");
         ImGui::PushID("Translation");
         ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x / widthFactor);
-        ImGui::DragFloat("X##Translation", &ent_transform.translation.x, 0.1f);
+        bool transformChanged = false;
+        transformChanged |= ImGui::DragFloat("X##Translation", &ent_transform.translation.x, 0.1f);
         ImGui::SameLine();
-        ImGui::DragFloat("Y##Translation", &ent_transform.translation.y, 0.1f);
+        transformChanged |= ImGui::DragFloat("Y##Translation", &ent_transform.translation.y, 0.1f);
         ImGui::SameLine();
-        ImGui::DragFloat("Z##Translation", &ent_transform.translation.z, 0.1f);
+        transformChanged |= ImGui::DragFloat("Z##Translation", &ent_transform.translation.z, 0.1f);
         ImGui::PopItemWidth();
         ImGui::PopID();
 
@@ -478,7 +514,10 @@ namespace vk
             rotationChanged = true;
 
         if (rotationChanged)
+        {
             ent_transform.rotation = glm::quat(glm::radians(glm::vec3(pitch, yaw, roll)));
+            transformChanged = true;
+        }
 
         ImGui::PopItemWidth();
         ImGui::PopID();
@@ -486,14 +525,17 @@ namespace vk
         ImGui::Text("Scale");
         ImGui::PushID("Scale");
         ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x / widthFactor);
-        ImGui::DragFloat("X##Scale", &ent_transform.scale.x, 0.1f, 0.f, 100.0f);
+        transformChanged |= ImGui::DragFloat("X##Scale", &ent_transform.scale.x, 0.1f, 0.f, 100.0f);
         ImGui::SameLine();
-        ImGui::DragFloat("Y##Scale", &ent_transform.scale.y, 0.1f, 0.f, 100.0f);
+        transformChanged |= ImGui::DragFloat("Y##Scale", &ent_transform.scale.y, 0.1f, 0.f, 100.0f);
         ImGui::SameLine();
-        ImGui::DragFloat("Z##Scale", &ent_transform.scale.z, 0.1f, 0.f, 100.0f);
+        transformChanged |= ImGui::DragFloat("Z##Scale", &ent_transform.scale.z, 0.1f, 0.f, 100.0f);
         ImGui::PopItemWidth();
         ImGui::PopID();
 
+        if (transformChanged)
+            _scene.mark_changed<eng::transform_t>(_currentlySelected);
+
         ImGui::EndChild();
     }
 
@@ -507,7 +549,7 @@ namespace vk
             ImGui::Text("%s", model.name().c_str());
             if (ImGui::Button("Remove Model", ImVec2(ImGui::GetContentRegionAvail().x, 20.f)))
             {
-                _scene.remove<eng::model_t>(_currentlySelected);
+                _world.commands().local().remove<eng::model_t>(_currentlySelected);
             }
             ImGui::EndChild();
         }
@@ -547,7 +589,7 @@ namespace vk
             }
             if (ImGui::Button("Remove Texture", ImVec2(ImGui::GetContentRegionAvail().x, 20.f)))
             {
-                _scene.remove<eng::texture_t>(_currentlySelected);
+                _world.commands().local().remove<eng::texture_t>(_currentlySelected);
             }
             ImGui::EndChild();
         }
@@ -565,7 +607,8 @@ namespace vk
         globalBuffer->update(&globalubo);
         globalBuffer->bindUniform(cmd, pipeline->layout(), device, globaluboChannelInfo);
 
-        renderer->renderScene();
+        renderer->setCamera(cam.getProjection(), cam.getView());
+        _worlds.render(*renderer);
     }
 
     void vk_engine::createImageSet()
@@ -627,16 +670,6 @@ namespace vk
 
     void vk_engine::runMainLoop()
     {
-        ecs::entity_id_t modelId = _scene.create();
-        auto& transform = _scene.construct<eng::transform_t>(modelId);
-        transform.translation = {0.f, 0.f, 2.0f};
-        transform.applyRotation(glm::vec3(0.f, 180.0f, 0.f));
-
-        auto& model = _scene.construct<eng::model_t>(modelId);
-        eng::modelloader_t::loadModel("C:\\Users\\gabri\\OneDrive\\Documentos\\GitHub\\VulkanSetup\\src\\resource\\suzane.obj", &model);
-        
-        _scene.construct<core::name_t>(modelId, "Suzane");
-
         while (!window->should_close())
         {
             glfwPollEvents();
@@ -655,6 +688,9 @@ namespace vk
                 shouldRecreateOffscreen = false;
             }
 
+            // steps every world on the job system, each one ends on its frame boundary
+            _worlds.update();
+
             if (VkCommandBuffer cmd = renderer->startFrame()) 
             {
                 renderer->beginOffscreenPass(cmd);
@@ -11,9 +11,12 @@
 #include "core/imageloader.hpp"
 
 #include "core/ecs.hpp"
+#include "engine/components.hpp"
 #include "core/ecs_defines.hpp"
+#include "core/ecs_prefab.hpp"
 #include "core/systemactor.hpp"
 #include "engine/transform_t.hpp"
+#include "engine/world_manager_t.hpp"
 #include "engine/camera_t.hpp"
 #include "engine/modelloader_t.hpp"
 
@@ -36,7 +39,7 @@ namespace vk
 
         void runMainLoop();
 
-        frameinfo_t getFrameInfo() const { return vk_renderer::getFrameInfo(); }
+        frameinfo_t getFrameInfo() const { return renderer->getFrameInfo(); }
     private:
         struct globalUbo
         {
@@ -101,9 +104,15 @@ namespace vk
         VkDescriptorPool imguiPool;
 
         // scene related
-        ecs::scene_t<> _scene;
+        eng::world_manager_t _worlds;
+        // the edited level, the editor panels work on it
+        eng::world_t& _world = _worlds.createWorld("Level");
+        ecs::scene_t<>& _scene = _world.scene();
         eng::camera_t cam{_scene}; // Temporary
 
+        // templates spawned into the worlds in batches
+        ecs::prefab_library_t<> _prefabs;
+
         std::vector<std::unique_ptr<core::systemactor>> _actors;
     };
 } // namespace vk
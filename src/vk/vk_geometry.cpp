@@ -0,0 +1,129 @@
+#include "vk_geometry.hpp"
+
+#include <algorithm>
+
+namespace vk
+{
+    const vk_geometry_buffer::range_t& vk_geometry_buffer::add(const eng::model_t& model, std::vector<std::unique_ptr<vk_buffer>>& retired)
+    {
+        const auto& vertices = model.vertices();
+        const auto& indices = model.indices();
+
+        auto it = _entries.find(vertices.get());
+        if (it != _entries.end())
+        {
+            if (!it->second.vertices.expired())
+                return it->second.range;
+
+            // a new mesh at the address of a released one
+            _entries.erase(it);
+        }
+
+        entry_t entry;
+        entry.vertices = vertices;
+        entry.vertexCount = static_cast<uint32_t>(vertices->size());
+        entry.range.firstIndex = static_cast<uint32_t>(_indices.size());
+        entry.range.indexCount = static_cast<uint32_t>(indices->size());
+        entry.range.vertexOffset = static_cast<int32_t>(_vertices.size());
+
+        const size_t firstVertex = _vertices.size();
+        _vertices.insert(_vertices.end(), vertices->begin(), vertices->end());
+        _indices.insert(_indices.end(), indices->begin(), indices->end());
+
+        if (_vertices.size() > _vertexCapacity || _indices.size() > _indexCapacity)
+        {
+            grow(_vertices.size(), _indices.size(), retired);
+        }
+        else
+        {
+            _vertexBuffer->write(vertices->data(), sizeof(eng::model_t::vertex_t) * vertices->size(),
+                                 sizeof(eng::model_t::vertex_t) * firstVertex);
+            _indexBuffer->write(indices->data(), sizeof(eng::model_t::index_t) * indices->size(),
+                                sizeof(eng::model_t::index_t) * entry.range.firstIndex);
+        }
+
+        return _entries.emplace(vertices.get(), std::move(entry)).first->second.range;
+    }
+
+    void vk_geometry_buffer::collect(std::vector<std::unique_ptr<vk_buffer>>& retired)
+    {
+        size_t liveIndices = 0;
+        for (auto it = _entries.begin(); it != _entries.end();)
+        {
+            if (it->second.vertices.expired())
+            {
+                it = _entries.erase(it);
+            }
+            else
+            {
+                liveIndices += it->second.range.indexCount;
+                ++it;
+            }
+        }
+
+        // dead meshes only cost memory, compact once they are the majority
+        if (!_indexBuffer || liveIndices * 2 >= _indices.size())
+            return;
+
+        std::vector<eng::model_t::vertex_t> vertices;
+        std::vector<eng::model_t::index_t> indices;
+        indices.reserve(liveIndices);
+
+        for (auto& [key, entry] : _entries)
+        {
+            range_t& range = entry.range;
+            const auto firstVertex = _vertices.begin() + range.vertexOffset;
+            const auto firstIndex = _indices.begin() + range.firstIndex;
+
+            range.vertexOffset = static_cast<int32_t>(vertices.size());
+            range.firstIndex = static_cast<uint32_t>(indices.size());
+            // indices are relative to vertexOffset, they are copied as is
+            vertices.insert(vertices.end(), firstVertex, firstVertex + entry.vertexCount);
+            indices.insert(indices.end(), firstIndex, firstIndex + range.indexCount);
+        }
+
+        _vertices = std::move(vertices);
+        _indices = std::move(indices);
+
+        // frames in flight still draw from the old layout, so the data goes to new buffers
+        recreate(retired);
+    }
+
+    void vk_geometry_buffer::bind(VkCommandBuffer cmd)
+    {
+        VkBuffer vertexBuffers[] = { _vertexBuffer->buffer() };
+        VkDeviceSize offsets[] = { 0 };
+
+        vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(cmd, _indexBuffer->buffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void vk_geometry_buffer::grow(size_t vertexCount, size_t indexCount, std::vector<std::unique_ptr<vk_buffer>>& retired)
+    {
+        _vertexCapacity = std::max(vertexCount, _vertexCapacity * 2);
+        _indexCapacity = std::max(indexCount, _indexCapacity * 2);
+        recreate(retired);
+    }
+
+    void vk_geometry_buffer::recreate(std::vector<std::unique_ptr<vk_buffer>>& retired)
+    {
+        // the frames in flight are done before the current frame's slot is reused, so retiring
+        // into it keeps the old buffers alive long enough for every frame that bound them
+        if (_vertexBuffer)
+            retired.push_back(std::move(_vertexBuffer));
+        if (_indexBuffer)
+            retired.push_back(std::move(_indexBuffer));
+
+        _vertexBuffer = std::make_unique<vk_buffer>(nullptr,
+                                    sizeof(eng::model_t::vertex_t) * _vertexCapacity,
+                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+        _indexBuffer = std::make_unique<vk_buffer>(nullptr,
+                                    sizeof(eng::model_t::index_t) * _indexCapacity,
+                                    VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+        _vertexBuffer->write(_vertices.data(), sizeof(eng::model_t::vertex_t) * _vertices.size());
+        _indexBuffer->write(_indices.data(), sizeof(eng::model_t::index_t) * _indices.size());
+    }
+} // namespace vk
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include "vk_buffer.hpp"
+#include "engine/model_t.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vk
+{
+    // one vertex and one index buffer holding every mesh drawn indirectly, so a single
+    // bind serves all draws of a frame. meshes are appended on first use and dropped by collect
+    // once their model is gone
+    class vk_geometry_buffer
+    {
+    public:
+        // where a mesh lives, in the terms of VkDrawIndexedIndirectCommand
+        struct range_t
+        {
+            uint32_t firstIndex = 0;
+            uint32_t indexCount = 0;
+            int32_t vertexOffset = 0;
+        };
+
+        vk_geometry_buffer() = default;
+
+        vk_geometry_buffer(const vk_geometry_buffer&) = delete;
+        vk_geometry_buffer& operator=(const vk_geometry_buffer&) = delete;
+
+        // returns the range of the model's mesh, appending it when it is new. when the buffers
+        // have to grow the old ones are moved to retired, draws recorded earlier may still use them
+        const range_t& add(const eng::model_t& model, std::vector<std::unique_ptr<vk_buffer>>& retired);
+
+        // forgets the meshes whose vertex data was released, and compacts the buffers once dead
+        // meshes fill most of them. call it before recording any draw of the frame, ranges move
+        void collect(std::vector<std::unique_ptr<vk_buffer>>& retired);
+
+        void bind(VkCommandBuffer cmd);
+    private:
+        struct entry_t
+        {
+            // expired once the mesh is gone, its address may then belong to another mesh
+            std::weak_ptr<const std::vector<eng::model_t::vertex_t>> vertices;
+            uint32_t vertexCount = 0;
+            range_t range;
+        };
+
+        void grow(size_t vertexCount, size_t indexCount, std::vector<std::unique_ptr<vk_buffer>>& retired);
+        // replaces both buffers with new ones of the current capacity, filled from the cpu copy
+        void recreate(std::vector<std::unique_ptr<vk_buffer>>& retired);
+
+        std::unordered_map<const void*, entry_t> _entries;
+
+        // cpu copy of the buffers, grown buffers are filled from it
+        std::vector<eng::model_t::vertex_t> _vertices;
+        std::vector<eng::model_t::index_t> _indices;
+
+        std::unique_ptr<vk_buffer> _vertexBuffer;
+        std::unique_ptr<vk_buffer> _indexBuffer;
+        size_t _vertexCapacity = 0;
+        size_t _indexCapacity = 0;
+    };
+} // namespace vk
@@ -1,11 +1,10 @@
 #include "vk_renderer.hpp"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 namespace vk
 {
-    frameinfo_t vk_renderer::_info;
-
     vk_renderer::vk_renderer(
         std::unique_ptr<vk_pipeline>& pipeline, 
         std::unique_ptr<vk_device>& device, 
@@ -17,6 +16,9 @@ namespace vk
         offscreen(offscreen)
     {
         createCommandBuffers();
+        setIndirect(true);
+        // sub pixel draws cost a full vertex pass and cover nothing
+        _culler.setMinPixelSize(1.0f);
     }
 
     vk_renderer::~vk_renderer()
@@ -213,6 +215,11 @@ namespace vk
 
         isFrameRunning = true;
         _info.cmd = cmd;
+        _instances.clear();
+        _drawCommands.clear();
+        _frameStats = {};
+        _retired[swapchain->getCurrentFrame()].clear();
+        _geometry.collect(_retired[swapchain->getCurrentFrame()]);
         
         ImGui_ImplGlfw_NewFrame();
         ImGui_ImplVulkan_NewFrame();
@@ -233,18 +240,166 @@ namespace vk
             throw std::runtime_error("Failed to end command buffer!");
 
         swapchain->submitCommandBuffers(&cmd, &imageIndex);
+        _stats = _frameStats;
 
         _info.cmd = VK_NULL_HANDLE;
         isFrameRunning = false;
     }
 
-    void vk_renderer::renderScene()
+    void vk_renderer::setCamera(const glm::mat4& projection, const glm::mat4& view)
+    {
+        _culler.setCamera(projection, view, static_cast<float>(extent().height));
+    }
+
+    void vk_renderer::renderScene(ecs::scene_t<>& scene, const eng::bvh_t* bvh)
     {
         assert(isFrameRunning && "Must have started the frame before rendering!");
         VkCommandBuffer cmd = currentCommandBuffer();
 
-        pipeline->bind(cmd);
+        // models and cached world matrices are an owning group, so this walks both dense arrays in lockstep.
+        // the matrices come from the front copy, the simulation is free to write the live one meanwhile
+        auto group = scene.group<eng::model_t, eng::world_transform_t>();
+        const ecs::entity_id_t* ids = group.entities();
+        eng::model_t* models = group.data<eng::model_t>();
+        const eng::world_transform_t* worlds = group.front<eng::world_transform_t>();
+
+        if (group.size() == 0)
+            return;
+
+        _candidates.clear();
+        if (bvh != nullptr)
+        {
+            bvh->queryFrustum(_culler.planes(), [&](uint64_t id) {
+                if (group.contains(id))
+                    _candidates.push_back(group.index(id));
+            });
+        }
+        else
+        {
+            _candidates.resize(group.size());
+            for (uint32_t i = 0; i < group.size(); ++i)
+                _candidates[i] = i;
+        }
+
+        _culler.clear();
+        for (uint32_t i : _candidates)
+            _culler.add(worlds[i].matrix, models[i].bounds());
+
+        const std::vector<uint32_t>& visible = _culler.cull();
+        if (visible.empty())
+            return;
+
+        // one pipeline and one bindless texture set for now, so only mesh and depth vary between draws
+        _queue.clear();
+        for (uint32_t candidate : visible)
+        {
+            const uint32_t i = _candidates[candidate];
+            const uint32_t depth = eng::render_queue_t::quantizeDepth(_culler.depth(glm::vec3(worlds[i].matrix[3])));
+            _queue.push(eng::render_queue_t::makeKey(opaquePass, 0, 0, meshId(models[i]), depth), i);
+        }
+        _queue.sort();
+
+        // every run of equal state becomes one instanced draw, front to back inside it
+        const uint32_t first = static_cast<uint32_t>(_instances.size());
+        _batches.clear();
+
+        for (const eng::render_queue_t::item_t& item : _queue.items())
+        {
+            const uint32_t i = item.draw;
+            instance_t& instance = _instances.emplace_back();
+            instance.modelMatrix = worlds[i].matrix;
+
+            if (scene.has<eng::texture_t>(ids[i]))
+                instance.textureId = scene.get<eng::texture_t>(ids[i]).id;
+
+            if (_batches.empty() || eng::render_queue_t::state(_batches.back().key) != eng::render_queue_t::state(item.key))
+                _batches.push_back({ &models[i], item.key, static_cast<uint32_t>(_instances.size()) - 1, 0 });
+
+            ++_batches.back().instanceCount;
+        }
+
+        uploadInstances(first);
+
+        instance_buffer_t& instances = _instanceBuffers[swapchain->getCurrentFrame()];
+        vkCmdBindDescriptorSets(
+            cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipeline->layout(),
+            instances.channel.channelIndex,
+            1,
+            &device->getDescriptorSet(instances.channel.channelIndex),
+            0,
+            nullptr
+        );
+        ++_frameStats.descriptorBinds;
+
+        pcPush push = { instances.channel.index };
+        vkCmdPushConstants(
+            cmd,
+            pipeline->layout(),
+            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            0,
+            sizeof(push),
+            &push
+        );
+
+        // what the previous batch left bound, binds are only recorded when the batch needs something else
+        uint32_t boundPipeline = UINT32_MAX;
+        uint32_t boundMaterial = UINT32_MAX;
+        uintptr_t boundMesh = 0;
+        const uint32_t vertexBufferBinds = _frameStats.vertexBufferBinds;
+
+        for (size_t b = 0; b < _batches.size();)
+        {
+            const batch_t& batch = _batches[b];
+
+            if (eng::render_queue_t::pipeline(batch.key) != boundPipeline)
+            {
+                boundPipeline = eng::render_queue_t::pipeline(batch.key);
+                pipeline->bind(cmd);
+                ++_frameStats.pipelineBinds;
+            }
+
+            if (eng::render_queue_t::material(batch.key) != boundMaterial)
+            {
+                boundMaterial = eng::render_queue_t::material(batch.key);
+                bindMaterial(cmd);
+            }
+
+            if (_indirect)
+            {
+                // batches up to the next pipeline or material change share one submission
+                const uint64_t sharedState = batch.key >> (eng::render_queue_t::meshBits + eng::render_queue_t::depthBits);
+                size_t end = b + 1;
+                while (end < _batches.size() &&
+                       (_batches[end].key >> (eng::render_queue_t::meshBits + eng::render_queue_t::depthBits)) == sharedState)
+                    ++end;
+
+                drawIndirect(cmd, b, static_cast<uint32_t>(end - b));
+                b = end;
+                continue;
+            }
+
+            if (batch.model->meshKey() != boundMesh)
+            {
+                boundMesh = batch.model->meshKey();
+                batch.model->bind(cmd);
+                ++_frameStats.vertexBufferBinds;
+            }
 
+            batch.model->draw(cmd, batch.instanceCount, batch.firstInstance);
+            ++_frameStats.drawCalls;
+            ++b;
+        }
+
+        // against binding the mesh of every visible object
+        _frameStats.draws += _queue.size();
+        _frameStats.vertexBufferBindsAvoided += _queue.size() - (_frameStats.vertexBufferBinds - vertexBufferBinds);
+    }
+
+    void vk_renderer::bindMaterial(VkCommandBuffer cmd)
+    {
+        // textures are bindless, every material binds the same sets and picks its texture per instance
         for (const uint32_t& index : _info.channelIndices.combinedImageSamplerIndices)
         {
             vkCmdBindDescriptorSets(
@@ -257,29 +412,99 @@ namespace vk
                 0,
                 nullptr
             );
+            ++_frameStats.descriptorBinds;
         }
-        
-        _info.scene->for_all<eng::model_t, eng::transform_t>([&](ecs::entity_id_t id, eng::model_t& model, eng::transform_t& transform) 
+    }
+
+    uint32_t vk_renderer::meshId(const eng::model_t& model)
+    {
+        // sort keys hold a dense id instead of the mesh key, ids are handed out on first sight
+        auto [it, inserted] = _meshIds.try_emplace(model.meshKey(), static_cast<uint32_t>(_meshIds.size()));
+        assert(it->second < (1u << eng::render_queue_t::meshBits) && "more meshes than the sort key can hold");
+        return it->second;
+    }
+
+    void vk_renderer::uploadInstances(uint32_t first)
+    {
+        const uint32_t frame = swapchain->getCurrentFrame();
+        instance_buffer_t& instances = _instanceBuffers[frame];
+        const uint32_t count = static_cast<uint32_t>(_instances.size());
+
+        if (count > instances.capacity)
         {
-            pcPush push = { transform.mat4(), 0 };
+            // descriptors bound earlier this frame still name the old buffer until the update below
+            if (instances.buffer)
+                _retired[frame].push_back(std::move(instances.buffer));
+
+            instances.capacity = std::max(count, instances.capacity * 2);
+            instances.buffer = std::make_unique<vk_buffer>(nullptr,
+                                    sizeof(instance_t) * instances.capacity,
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = instances.buffer->buffer();
+            bufferInfo.offset = 0;
+            bufferInfo.range = VK_WHOLE_SIZE;
+
+            vk_descriptordata bufferData{};
+            bufferData.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bufferData.pBufferInfo = &bufferInfo;
+
+            // update after bind, draws recorded earlier this frame read the new buffer too
+            instances.channel = device->setDescriptorData(bufferData, instances.channel.channelIndex, instances.channel.index);
+            first = 0;
+        }
 
-            if (_info.scene->has<eng::texture_t>(id))
-            {
-                auto& texId = _info.scene->get<eng::texture_t>(id); 
-                push.textureId = texId.id;
-            }
+        instances.buffer->write(_instances.data() + first, sizeof(instance_t) * (count - first), sizeof(instance_t) * first);
+    }
 
-            vkCmdPushConstants(
-                cmd,
-                pipeline->layout(),
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(push),
-                &push
-            );
+    void vk_renderer::drawIndirect(VkCommandBuffer cmd, size_t firstBatch, uint32_t batchCount)
+    {
+        const uint32_t frame = swapchain->getCurrentFrame();
+        const uint32_t first = static_cast<uint32_t>(_drawCommands.size());
+
+        for (size_t b = firstBatch; b < firstBatch + batchCount; ++b)
+        {
+            const batch_t& batch = _batches[b];
+            const vk_geometry_buffer::range_t& range = _geometry.add(*batch.model, _retired[frame]);
+
+            VkDrawIndexedIndirectCommand& command = _drawCommands.emplace_back();
+            command.indexCount = range.indexCount;
+            command.instanceCount = batch.instanceCount;
+            command.firstIndex = range.firstIndex;
+            command.vertexOffset = range.vertexOffset;
+            command.firstInstance = batch.firstInstance;
+        }
+
+        // commands recorded earlier this frame point at the old buffer, so it is retired rather than rewritten
+        indirect_buffer_t& commands = _indirectBuffers[frame];
+        const uint32_t count = static_cast<uint32_t>(_drawCommands.size());
+
+        if (count > commands.capacity)
+        {
+            if (commands.buffer)
+                _retired[frame].push_back(std::move(commands.buffer));
+
+            commands.capacity = std::max(count, commands.capacity * 2);
+            commands.buffer = std::make_unique<vk_buffer>(nullptr,
+                                    sizeof(VkDrawIndexedIndirectCommand) * commands.capacity,
+                                    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                    VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+
+        const uint32_t drawCount = count - first;
+        commands.buffer->write(_drawCommands.data() + first,
+                               sizeof(VkDrawIndexedIndirectCommand) * drawCount,
+                               sizeof(VkDrawIndexedIndirectCommand) * first);
+
+        // bound again per submission, adding meshes may have replaced the buffers
+        _geometry.bind(cmd);
+        ++_frameStats.vertexBufferBinds;
 
-            model.bind(cmd);
-            model.draw(cmd);
-        });
+        vkCmdDrawIndexedIndirect(cmd, commands.buffer->buffer(),
+                                 sizeof(VkDrawIndexedIndirectCommand) * first,
+                                 drawCount, sizeof(VkDrawIndexedIndirectCommand));
+        ++_frameStats.drawCalls;
     }
 } // namespace vk
@@ -9,22 +9,55 @@
 #include "vk_swapchain.hpp"
 #include "vk_offscreen.hpp"
 #include "vk_pipeline.hpp"
+#include "vk_geometry.hpp"
 
 #include "engine/model_t.hpp"
+#include "engine/frustum_culler_t.hpp"
+#include "engine/bvh_t.hpp"
+#include "engine/render_queue_t.hpp"
+#include "engine/hierarchy_t.hpp"
 #include "core/ecs.hpp"
+#include "engine/components.hpp"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace vk
 {
     struct pcPush
     {
-        alignas(16) glm::mat4 modelMatrix;
-        alignas(16) uint32_t textureId = 0;
+        // element of the storage buffer array holding this frame's instances
+        uint32_t instanceBuffer = 0;
+    };
+
+    // per instance data read by test.vert through gl_InstanceIndex, std430 layout
+    struct instance_t
+    {
+        glm::mat4 modelMatrix;
+        uint32_t textureId = 0;
+        uint32_t padding[3] = {};
+    };
+    static_assert(sizeof(instance_t) == 80, "instance_t must match the std430 layout in test.vert");
+
+    // counted over a frame, vk_renderer::stats returns the last finished one
+    struct render_stats_t
+    {
+        // visible objects
+        uint32_t draws = 0;
+        // one per instanced batch, or per indirect submission
+        uint32_t drawCalls = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t descriptorBinds = 0;
+        uint32_t vertexBufferBinds = 0;
+        // against binding the mesh of every visible object
+        uint32_t vertexBufferBindsAvoided = 0;
     };
 
     struct frameinfo_t
     {
         VkCommandBuffer cmd = VK_NULL_HANDLE;
-        ecs::scene_t<>* scene = nullptr;
 
         float deltaTime = 0.0f;
 
@@ -49,14 +82,28 @@ namespace vk
         void beginOffscreenPass(VkCommandBuffer cmd);
         void endOffscreenPass(VkCommandBuffer cmd);
 
-        void setScene(ecs::scene_t<>& scene) { _info.scene = &scene; }
-        void renderScene();
+        // records the draws of one world, call it once per world that should be visible. with a bvh
+        // over the scene's renderables only the leaves the frustum reaches are culled further
+        void renderScene(ecs::scene_t<>& scene, const eng::bvh_t* bvh = nullptr);
         void renderInterface();
         
+        // the camera the next renderScene calls cull against
+        void setCamera(const glm::mat4& projection, const glm::mat4& view);
+        // draws smaller than this on screen are skipped
+        void setMinPixelSize(float pixels) { _culler.setMinPixelSize(pixels); }
+
+        VkExtent2D extent() { return offscreen == nullptr ? swapchain->extent() : offscreen->get()->extent(); }
         float aspectRatio() { return offscreen == nullptr ? swapchain->getAspectRatio() : offscreen->get()->aspectRatio(); }
 
-        static frameinfo_t& getFrameInfo() { return _info; }
-        static float dt() { return _info.deltaTime; }
+        // indirect mode records one multi draw per scene out of a shared geometry buffer instead of
+        // one draw per batch. only honoured when the device supports multi draw indirect
+        void setIndirect(bool enabled) { _indirect = enabled && device->supportsMultiDrawIndirect(); }
+        bool indirect() const { return _indirect; }
+
+        const render_stats_t& stats() const { return _stats; }
+
+        frameinfo_t& getFrameInfo() { return _info; }
+        float dt() const { return _info.deltaTime; }
     private:
         std::unique_ptr<vk_offscreen_renderer>* offscreen = nullptr;
 
@@ -66,7 +113,7 @@ namespace vk
         std::unique_ptr<vk_pipeline>& pipeline;
         vk_context& context;
 
-        static frameinfo_t _info;
+        frameinfo_t _info;
 
         VkCommandBuffer currentCommandBuffer() { return commandBuffers[imageIndex]; }
         void createCommandBuffers();
@@ -75,10 +122,66 @@ namespace vk
 
         void endRenderpass(VkCommandBuffer cmd);
 
+        // uploads _instances from first on, growing the frame's buffer when it is too small
+        void uploadInstances(uint32_t first);
+        void drawIndirect(VkCommandBuffer cmd, size_t firstBatch, uint32_t batchCount);
+        void bindMaterial(VkCommandBuffer cmd);
+        uint32_t meshId(const eng::model_t& model);
+
         std::vector<VkCommandBuffer> commandBuffers;
         uint32_t imageIndex = 0;
 
         bool isFrameRunning = false;
+
+        struct instance_buffer_t
+        {
+            std::unique_ptr<vk_buffer> buffer;
+            // element in the storage buffer channel, kept when the buffer grows
+            vk_channelindices channel;
+            uint32_t capacity = 0;
+        };
+
+        // consecutive instances sharing all state, drawn with one call
+        struct batch_t
+        {
+            eng::model_t* model;
+            // sort key of the first instance
+            uint64_t key;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+        };
+
+        // one per frame in flight, indexed by the swapchain's current frame
+        std::array<instance_buffer_t, vk_swapchain::getMaxFramesInFlights()> _instanceBuffers;
+        // every instance written this frame, across all rendered scenes
+        std::vector<instance_t> _instances;
+        std::vector<batch_t> _batches;
+
+        eng::frustum_culler_t _culler;
+        // group indices handed to the culler
+        std::vector<uint32_t> _candidates;
+
+        static constexpr uint32_t opaquePass = 0;
+        eng::render_queue_t _queue;
+        std::unordered_map<uintptr_t, uint32_t> _meshIds;
+
+        render_stats_t _frameStats;
+        render_stats_t _stats;
+
+        bool _indirect = false;
+        vk_geometry_buffer _geometry;
+
+        struct indirect_buffer_t
+        {
+            std::unique_ptr<vk_buffer> buffer;
+            uint32_t capacity = 0;
+        };
+
+        // draw commands of the frame, one per batch, indexed like _instanceBuffers
+        std::array<indirect_buffer_t, vk_swapchain::getMaxFramesInFlights()> _indirectBuffers;
+        std::vector<VkDrawIndexedIndirectCommand> _drawCommands;
+        // buffers replaced while recording a frame, freed once its slot comes around again
+        std::array<std::vector<std::unique_ptr<vk_buffer>>, vk_swapchain::getMaxFramesInFlights()> _retired;
     };
     
 } // namespace vk
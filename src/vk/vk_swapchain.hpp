@@ -46,7 +46,8 @@ namespace vk
         VkCommandPool commandPool() { return _commandPool; }
 
         uint32_t imageAmmount() { return _images.size(); }
-        size_t getCurrentFrame() { return _currentFrame; }
+        // frame slot the last acquireNextImage waited for, resources indexed by it are free to reuse
+        size_t getCurrentFrame() { return currentFrame; }
 
         float getAspectRatio() { return static_cast<float>(_extent.width) / static_cast<float>(_extent.height); }
     private:
@@ -63,7 +64,6 @@ namespace vk
         // validations
         void checkFormatSupport();
 
-        uint32_t _currentFrame = 0;
         static constexpr size_t MAX_FRAMES_IN_FLIGHT = 2;
 
         VkSwapchainKHR _swapchain = VK_NULL_HANDLE;
@@ -0,0 +1,92 @@
+#include "test.hpp"
+#include "engine/bvh_t.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace eng;
+
+static aabb_t box(const glm::vec3& center, float size)
+{
+    return { center - glm::vec3(size), center + glm::vec3(size) };
+}
+
+// many leaves moving in the same frame, tree kept up to date by refit alone
+static void refitMovedLeaves()
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> step(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+    bvh_t bvh;
+    std::vector<glm::vec3> centers;
+    std::vector<float> sizes;
+    std::vector<bvh_t::proxy_t> proxies;
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        centers.push_back({position(rng), position(rng), position(rng)});
+        sizes.push_back(size(rng));
+        proxies.push_back(bvh.insert(box(centers[i], sizes[i]), i));
+    }
+    bvh.refit();
+    CHECK(bvh.validate());
+
+    for (uint32_t frame = 0; frame < 60; ++frame)
+    {
+        for (uint32_t i = 0; i < centers.size(); ++i)
+        {
+            if (rng() % 3 != 0)
+                continue;
+            centers[i] += glm::vec3(step(rng), step(rng), step(rng));
+            bvh.update(proxies[i], box(centers[i], sizes[i]));
+        }
+        bvh.refit();
+        CHECK(bvh.validate());
+
+        for (uint32_t i = 0; i < centers.size(); ++i)
+        {
+            bool found = false;
+            bvh.queryAabb(box(centers[i], sizes[i]), [&](uint64_t user) { found |= user == i; });
+            CHECK(found);
+        }
+    }
+}
+
+// inserts and removals between updates, refit and partial rebuilds interleaved
+static void churn()
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+    bvh_t bvh;
+    std::vector<bvh_t::proxy_t> proxies;
+    for (uint32_t frame = 0; frame < 200; ++frame)
+    {
+        for (uint32_t i = 0; i < 20; ++i)
+            proxies.push_back(bvh.insert(box({position(rng), position(rng), position(rng)}, 1.0f), proxies.size()));
+        for (uint32_t i = 0; i < proxies.size(); i += 4)
+            bvh.update(proxies[i], box({position(rng), position(rng), position(rng)}, 2.0f));
+        for (uint32_t i = 0; i < 5 && !proxies.empty(); ++i)
+        {
+            const size_t victim = rng() % proxies.size();
+            bvh.remove(proxies[victim]);
+            proxies[victim] = proxies.back();
+            proxies.pop_back();
+        }
+
+        bvh.refit();
+        if (frame % 16 == 0)
+            bvh.rebuildPartial();
+        CHECK(bvh.validate());
+        CHECK(bvh.size() == proxies.size());
+    }
+}
+
+int main()
+{
+    refitMovedLeaves();
+    churn();
+    std::puts("bvh_test passed");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "test.hpp"
+#include "core/ecs.hpp"
+#include "core/ecs_archetype.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct position_t
+{
+    float x, y, z;
+};
+
+struct velocity_t
+{
+    float x, y, z;
+};
+
+struct name_t
+{
+    std::string text;
+};
+
+ECS_COMPONENT(position_t, 0)
+ECS_COMPONENT(velocity_t, 1)
+ECS_COMPONENT(name_t, 2)
+
+static constexpr uint32_t entityCount = 100000;
+static constexpr uint32_t frameCount = 50;
+
+struct result_t
+{
+    double checksum = 0.0;
+    uint32_t moved = 0;
+    uint32_t named = 0;
+    double buildMs = 0.0;
+    double iterateMs = 0.0;
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// same structural changes and iteration on either backend, so the results must
+// match and the timings compare the two layouts. steps of 0.25 keep every sum
+// exact whatever order the backend visits the entities in
+template <typename scene_type>
+static result_t workload(scene_type& scene)
+{
+    result_t result;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ecs::entity_id_t> ids;
+    for (uint32_t i = 0; i < entityCount; ++i)
+    {
+        ecs::entity_id_t id = scene.create();
+        ids.push_back(id);
+        scene.template construct<position_t>(id, float(i), 0.0f, 0.0f);
+        if (i % 2 == 0)
+            scene.template construct<velocity_t>(id, 1.0f, float(i % 7), 0.5f);
+        if (i % 3 == 0)
+            scene.template construct<name_t>(id, std::to_string(i));
+    }
+    for (uint32_t i = 0; i < entityCount; i += 5)
+        if (scene.template has<velocity_t>(ids[i]))
+            scene.template remove<velocity_t>(ids[i]);
+    for (uint32_t i = 0; i < entityCount; i += 11)
+        scene.destroy(ids[i]);
+    result.buildMs = elapsedMs(start);
+
+    scene.template for_all<position_t, name_t>([&](ecs::entity_id_t, position_t& position, name_t& name) {
+        CHECK(name.text == std::to_string(uint32_t(position.x)));
+        ++result.named;
+    });
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frameCount; ++frame)
+        scene.template for_all<position_t, velocity_t>([](ecs::entity_id_t, position_t& position, velocity_t& velocity) {
+            position.x += velocity.x * 0.25f;
+            position.y += velocity.y * 0.25f;
+            position.z += velocity.z * 0.25f;
+        });
+    result.iterateMs = elapsedMs(start);
+
+    scene.template for_all<position_t, velocity_t>([&](ecs::entity_id_t, position_t& position, velocity_t&) {
+        result.checksum += position.x + position.y + position.z;
+        ++result.moved;
+    });
+    return result;
+}
+
+int main()
+{
+    ecs::scene_t<> sparse;
+    result_t sparseResult = workload(sparse);
+
+    ecs::archetype_scene_t<> archetype(entityCount);
+    result_t archetypeResult = workload(archetype);
+
+    CHECK(sparseResult.moved == archetypeResult.moved);
+    CHECK(sparseResult.named == archetypeResult.named);
+    CHECK(sparseResult.checksum == archetypeResult.checksum);
+
+    std::printf("sparse set: build %.2f ms, iterate %.2f ms\n", sparseResult.buildMs, sparseResult.iterateMs);
+    std::printf("archetype:  build %.2f ms, iterate %.2f ms\n", archetypeResult.buildMs, archetypeResult.iterateMs);
+    return 0;
+}
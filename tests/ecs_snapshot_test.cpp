@@ -0,0 +1,129 @@
+#include "test.hpp"
+#include "core/ecs_snapshot.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct position_t
+{
+    float x, y, z;
+};
+
+struct label_t
+{
+    std::string text;
+};
+
+struct label_record_t
+{
+    ecs::snapshot_string_t text;
+};
+
+ECS_COMPONENT(position_t, 0)
+ECS_COMPONENT(label_t, 1)
+
+static label_record_t toRecord(const label_t& label, ecs::snapshot_string_writer_t& strings)
+{
+    return { strings.add(label.text) };
+}
+
+static label_t fromRecord(const label_record_t& record, const ecs::snapshot_string_reader_t& strings)
+{
+    return { std::string(strings.get(record.text)) };
+}
+
+static ecs::snapshot_t<> makeSnapshot()
+{
+    ecs::snapshot_t<> snapshot;
+    snapshot.register_component<position_t>();
+    snapshot.register_component<label_t, label_record_t>(&toRecord, &fromRecord);
+    return snapshot;
+}
+
+static std::filesystem::path tempPath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+// saves a scene with holes in its entity list and reads it back into another
+static void roundTrip(const std::filesystem::path& path)
+{
+    ecs::snapshot_t<> snapshot = makeSnapshot();
+
+    ecs::scene_t<> saved;
+    std::vector<ecs::entity_id_t> ids;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        ecs::entity_id_t id = saved.create();
+        ids.push_back(id);
+        saved.construct<position_t>(id, float(i), 1.0f, 2.0f);
+        if (i % 3 == 0)
+            saved.construct<label_t>(id, "entity " + std::to_string(i));
+    }
+    for (uint32_t i = 0; i < 1000; i += 7)
+        saved.destroy(ids[i]);
+    CHECK(snapshot.save(saved, path));
+
+    ecs::scene_t<> loaded;
+    CHECK(snapshot.load(loaded, path));
+    CHECK(loaded.alive() == saved.alive());
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        ecs::entity_id_t id = ids[i];
+        CHECK(loaded.valid(id) == saved.valid(id));
+        if (!saved.valid(id))
+            continue;
+
+        CHECK(loaded.get<position_t>(id).x == float(i));
+        CHECK(loaded.has<label_t>(id) == saved.has<label_t>(id));
+        if (saved.has<label_t>(id))
+            CHECK(loaded.get<label_t>(id).text == saved.get<label_t>(id).text);
+    }
+
+    // recycled slots still hand out fresh generations
+    ecs::entity_id_t reused = loaded.create();
+    CHECK(!saved.valid(reused));
+}
+
+// every cut of the file is refused and leaves the scene untouched
+static void rejectTruncated(const std::filesystem::path& path)
+{
+    ecs::snapshot_t<> snapshot = makeSnapshot();
+
+    std::string file;
+    {
+        std::ifstream in(path, std::ios::binary);
+        file.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    CHECK(!file.empty());
+
+    std::filesystem::path truncated = tempPath("ecs_snapshot_test_truncated.bin");
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size < file.size(); size += 1 + size / 8)
+        sizes.push_back(size);
+    sizes.push_back(file.size() - 1);
+
+    for (size_t size : sizes)
+    {
+        {
+            std::ofstream out(truncated, std::ios::binary | std::ios::trunc);
+            out.write(file.data(), std::streamsize(size));
+        }
+
+        ecs::scene_t<> scene;
+        CHECK(!snapshot.load(scene, truncated));
+        CHECK(scene.alive() == 0);
+    }
+    std::filesystem::remove(truncated);
+}
+
+int main()
+{
+    std::filesystem::path path = tempPath("ecs_snapshot_test.bin");
+    roundTrip(path);
+    rejectTruncated(path);
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "test.hpp"
+#include "core/ecs.hpp"
+
+#include <string>
+#include <vector>
+
+struct label_t
+{
+    std::string text;
+};
+
+ECS_COMPONENT(label_t, 0)
+
+// long enough to live on the heap, so reading a moved from copy shows
+static const std::string text = "a label too long for the small string buffer";
+
+// the pool is full when the new component is built from one of its own, so
+// growing it moves the source before it is read
+static void constructFromSamePool()
+{
+    ecs::scene_t<> scene;
+    scene.reserve<label_t>(4);
+    ecs::entity_id_t first = scene.create();
+    scene.construct<label_t>(first, text);
+    for (uint32_t i = 1; i < 4; ++i)
+        scene.construct<label_t>(scene.create(), text);
+
+    ecs::entity_id_t copy = scene.create();
+    scene.construct<label_t>(copy, scene.get<label_t>(first));
+    CHECK(scene.get<label_t>(copy).text == text);
+    CHECK(scene.get<label_t>(first).text == text);
+}
+
+static void constructNFromSamePool()
+{
+    ecs::scene_t<> scene;
+    ecs::entity_id_t first = scene.create();
+    scene.construct<label_t>(first, text);
+
+    std::vector<ecs::entity_id_t> ids;
+    for (uint32_t i = 0; i < 100; ++i)
+        ids.push_back(scene.create());
+    scene.construct_n<label_t>(ids, scene.get<label_t>(first));
+
+    for (ecs::entity_id_t id : ids)
+        CHECK(scene.get<label_t>(id).text == text);
+    CHECK(scene.get<label_t>(first).text == text);
+}
+
+int main()
+{
+    constructFromSamePool();
+    constructNFromSamePool();
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// like assert, but also checked in release builds
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                                 \
+        }                                                                                 \
+    } while (0)
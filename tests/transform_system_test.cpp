@@ -0,0 +1,99 @@
+#include "test.hpp"
+#include "engine/transform_system_t.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace eng;
+
+static bool isAncestor(ecs::scene_t<>& scene, ecs::entity_id_t ancestor, ecs::entity_id_t id)
+{
+    for (; id != ecs::null_entity_id; id = scene.get<hierarchy_t>(id).parent)
+        if (id == ancestor)
+            return true;
+    return false;
+}
+
+// parent world * local, walking the links instead of trusting the system
+static glm::mat4 expectedWorld(ecs::scene_t<>& scene, ecs::entity_id_t id)
+{
+    glm::mat4 local = scene.get<transform_t>(id).mat4();
+    if (!scene.has<hierarchy_t>(id) || scene.get<hierarchy_t>(id).parent == ecs::null_entity_id)
+        return local;
+    return expectedWorld(scene, scene.get<hierarchy_t>(id).parent) * local;
+}
+
+static bool near(const glm::mat4& a, const glm::mat4& b)
+{
+    for (int column = 0; column < 4; ++column)
+        for (int row = 0; row < 4; ++row)
+            if (glm::abs(a[column][row] - b[column][row]) > 1e-3f * (1.0f + glm::abs(b[column][row])))
+                return false;
+    return true;
+}
+
+// random forest that is moved, relinked and pruned every frame
+static void propagate()
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> angle(-30.0f, 30.0f);
+
+    ecs::scene_t<> scene;
+    transform_system_t system(scene);
+
+    std::vector<ecs::entity_id_t> ids;
+    for (uint32_t i = 0; i < 400; ++i)
+    {
+        ecs::entity_id_t id = scene.create();
+        transform_t transform;
+        transform.translation = {offset(rng), offset(rng), offset(rng)};
+        transform.scale = glm::vec3(1.0f);
+        scene.construct<transform_t>(id, transform);
+        ids.push_back(id);
+    }
+
+    for (uint32_t frame = 0; frame < 60; ++frame)
+    {
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            ecs::entity_id_t child = ids[rng() % ids.size()];
+            ecs::entity_id_t parent = rng() % 8 == 0 ? ecs::null_entity_id : ids[rng() % ids.size()];
+            if (parent == child || (parent != ecs::null_entity_id && scene.has<hierarchy_t>(parent) && isAncestor(scene, child, parent)))
+                continue;
+            system.setParent(child, parent);
+        }
+
+        for (uint32_t i = 0; i < 30; ++i)
+            scene.patch<transform_t>(ids[rng() % ids.size()], [&](transform_t& transform) {
+                transform.translation += glm::vec3(offset(rng), offset(rng), offset(rng));
+                transform.applyRotation(glm::vec3(angle(rng), angle(rng), 0.0f));
+            });
+
+        if (frame % 10 == 9)
+        {
+            size_t victim = rng() % ids.size();
+            scene.destroy(ids[victim]);
+            ids.erase(ids.begin() + victim);
+        }
+
+        system.update();
+        scene.advance_tick();
+
+        uint32_t depth = 0;
+        for (auto [id, node] : scene.view<hierarchy_t>())
+        {
+            CHECK(node.depth >= depth);
+            depth = node.depth;
+        }
+
+        for (ecs::entity_id_t id : ids)
+            CHECK(near(scene.get<world_transform_t>(id).matrix, expectedWorld(scene, id)));
+    }
+}
+
+int main()
+{
+    propagate();
+    return 0;
+}